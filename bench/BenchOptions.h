@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <map>
+#include <string>
+
+// --key value pairs of a bench's command line
+struct Options {
+    std::map<std::string, std::string> values;
+    
+    double get(const std::string& key, double fallback) const {
+        auto it = values.find(key);
+        return it == values.end() ? fallback : std::atof(it->second.c_str());
+    }
+    std::string getString(const std::string& key, const std::string& fallback = std::string()) const {
+        auto it = values.find(key);
+        return it == values.end() ? fallback : it->second;
+    }
+};
+
+// only pairs of a known key and its value are accepted, numbers for the
+// numeric keys; anything else, --help included, prints the known keys and
+// returns false
+inline bool parseOptions(int argc, char* argv[], std::initializer_list<const char*> numeric,
+                         std::initializer_list<const char*> text, Options& options) {
+    auto known = [](std::initializer_list<const char*> keys, const char* key) {
+        for (const char* candidate : keys) {
+            if (std::strcmp(candidate, key) == 0) return true;
+        }
+        return false;
+    };
+    
+    std::string error;
+    for (int i = 1; i < argc && error.empty(); i += 2) {
+        const char* key = argv[i] + 2;
+        if (std::strncmp(argv[i], "--", 2) != 0) {
+            error = std::string("unexpected argument ") + argv[i];
+        } else if (!known(numeric, key) && !known(text, key)) {
+            error = std::string("unknown option ") + argv[i];
+        } else if (i + 1 >= argc) {
+            error = std::string("missing value for ") + argv[i];
+        } else {
+            char* end = nullptr;
+            std::strtod(argv[i + 1], &end);
+            if (known(numeric, key) && (end == argv[i + 1] || *end != '\0')) {
+                error = std::string("not a number for ") + argv[i] + ": " + argv[i + 1];
+            }
+            options.values[key] = argv[i + 1];
+        }
+    }
+    if (error.empty()) return true;
+    
+    std::fprintf(stderr, "%s: %s\nusage: %s [--option value]...\noptions:", argv[0], error.c_str(), argv[0]);
+    for (const char* key : numeric) std::fprintf(stderr, " --%s <n>", key);
+    for (const char* key : text) std::fprintf(stderr, " --%s <text>", key);
+    std::fprintf(stderr, "\n");
+    return false;
+}
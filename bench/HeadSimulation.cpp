@@ -0,0 +1,149 @@
+#include "HeadSimulation.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace {
+
+constexpr double DEG = M_PI / 180.0;
+
+// joint ranges of the simulated head, degrees
+constexpr double EYE_YAW_LIMIT = 50.0;
+constexpr double EYE_TILT_MIN = -35.0, EYE_TILT_MAX = 15.0;
+constexpr double NECK_PITCH_MIN = -40.0, NECK_PITCH_MAX = 30.0;
+constexpr double NECK_YAW_LIMIT = 55.0;
+constexpr double VERGENCE_MAX = 50.0;
+
+double approach(double value, double target, double maxStep) {
+    return value + std::max(-maxStep, std::min(maxStep, target - value));
+}
+
+} // namespace
+
+SimulatedHead::SimulatedHead() {
+    reset();
+}
+
+void SimulatedHead::reset() {
+    eyeYaw = eyeTilt = neckPitch = neckYaw = 0.0;
+    eyeYawTarget = eyeTiltTarget = 0.0;
+    eyeVelocityMode = false;
+    eyeYawVelocity = eyeTiltVelocity = 0.0;
+    vergence = vergenceTarget = 0.0;
+    neckPitchVelocity = neckYawVelocity = 0.0;
+    neckPitchReference = neckYawReference = 0.0;
+}
+
+void SimulatedHead::positionMoveEyes(double yaw, double tilt) {
+    eyeYawTarget = std::max(-EYE_YAW_LIMIT, std::min(EYE_YAW_LIMIT, yaw));
+    eyeTiltTarget = std::max(EYE_TILT_MIN, std::min(EYE_TILT_MAX, tilt));
+    eyeVelocityMode = false;
+}
+
+void SimulatedHead::velocityMoveEyes(double yawVelocity, double tiltVelocity) {
+    eyeYawVelocity = std::max(-EYE_SPEED, std::min(EYE_SPEED, yawVelocity));
+    eyeTiltVelocity = std::max(-EYE_SPEED, std::min(EYE_SPEED, tiltVelocity));
+    eyeVelocityMode = true;
+}
+
+void SimulatedHead::positionMoveVergence(double target) {
+    vergenceTarget = std::max(0.0, std::min(VERGENCE_MAX, target));
+}
+
+void SimulatedHead::velocityMoveNeck(double pitchVelocity, double yawVelocity) {
+    neckPitchReference = pitchVelocity;
+    neckYawReference = yawVelocity;
+}
+
+void SimulatedHead::step(double dt) {
+    if (eyeVelocityMode) {
+        eyeYaw = std::max(-EYE_YAW_LIMIT, std::min(EYE_YAW_LIMIT, eyeYaw + eyeYawVelocity * dt));
+        eyeTilt = std::max(EYE_TILT_MIN, std::min(EYE_TILT_MAX, eyeTilt + eyeTiltVelocity * dt));
+    } else {
+        eyeYaw = approach(eyeYaw, eyeYawTarget, EYE_SPEED * dt);
+        eyeTilt = approach(eyeTilt, eyeTiltTarget, EYE_SPEED * dt);
+    }
+    vergence = approach(vergence, vergenceTarget, EYE_SPEED * dt);
+    
+    neckPitchVelocity = approach(neckPitchVelocity, neckPitchReference, NECK_ACCELERATION * dt);
+    neckYawVelocity = approach(neckYawVelocity, neckYawReference, NECK_ACCELERATION * dt);
+    neckPitch = std::max(NECK_PITCH_MIN, std::min(NECK_PITCH_MAX, neckPitch + neckPitchVelocity * dt));
+    neckYaw = std::max(-NECK_YAW_LIMIT, std::min(NECK_YAW_LIMIT, neckYaw + neckYawVelocity * dt));
+}
+
+GazeController::Encoders SimulatedHead::getEncoders() const {
+    return GazeController::Encoders{eyeYaw, eyeTilt, neckPitch, neckYaw, neckPitchVelocity, neckYawVelocity};
+}
+
+std::vector<TargetJump> makeTargetJumps(unsigned seed, size_t count) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> azimuthJump(-20.0, 20.0);
+    std::uniform_real_distribution<double> elevationJump(-12.0, 12.0);
+    std::vector<TargetJump> jumps;
+    double azimuth = 0.0, elevation = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        azimuth = std::max(-MAX_TARGET_AZIMUTH, std::min(MAX_TARGET_AZIMUTH, azimuth + azimuthJump(rng)));
+        elevation = std::max(-MAX_TARGET_ELEVATION, std::min(MAX_TARGET_ELEVATION, elevation + elevationJump(rng)));
+        jumps.push_back({azimuth, elevation});
+    }
+    return jumps;
+}
+
+SyntheticCamera::SyntheticCamera(size_t width, size_t height, double horizontalFov) :
+    width(width),
+    height(height),
+    focal(width / (2.0 * std::tan(horizontalFov * DEG / 2.0))),
+    background(width * height * 3),
+    pixels(width * height * 3) {
+    // grey noise with warm patches that stay below the red threshold
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> noise(60, 180);
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            unsigned char* p = &background[(y * width + x) * 3];
+            const int level = noise(rng);
+            const bool warm = ((x / 32) + (y / 32)) % 5 == 0;
+            p[0] = static_cast<unsigned char>(warm ? std::min(255, level + 40) : level);
+            p[1] = static_cast<unsigned char>(level);
+            p[2] = static_cast<unsigned char>(warm ? level * 3 / 4 : level);
+        }
+    }
+}
+
+void SyntheticCamera::render(double targetAzimuth, double targetElevation,
+                             double gazeAzimuth, double gazeElevation, double radius) {
+    std::memcpy(pixels.data(), background.data(), pixels.size());
+    addSphere(targetAzimuth, targetElevation, gazeAzimuth, gazeElevation, radius);
+}
+
+void SyntheticCamera::addSphere(double azimuth, double elevation,
+                                double gazeAzimuth, double gazeElevation, double radius) {
+    // outside the half-space in front of the camera nothing is visible
+    const double dx = (azimuth - gazeAzimuth) * DEG;
+    const double dy = (elevation - gazeElevation) * DEG;
+    if (std::abs(dx) >= M_PI / 2 || std::abs(dy) >= M_PI / 2) return;
+    
+    const double cx = width / 2.0 + focal * std::tan(dx);
+    const double cy = height / 2.0 - focal * std::tan(dy);  // image y points down
+    const double r = focal * std::tan(radius * DEG);
+    
+    const long x0 = std::max(0L, static_cast<long>(std::floor(cx - r)));
+    const long x1 = std::min(static_cast<long>(width), static_cast<long>(std::ceil(cx + r)) + 1);
+    const long y0 = std::max(0L, static_cast<long>(std::floor(cy - r)));
+    const long y1 = std::min(static_cast<long>(height), static_cast<long>(std::ceil(cy + r)) + 1);
+    
+    for (long y = y0; y < y1; y++) {
+        for (long x = x0; x < x1; x++) {
+            const double ex = x - cx, ey = y - cy;
+            if (ex * ex + ey * ey > r * r) continue;
+            
+            // shaded sphere, darker towards the rim
+            const double shade = 1.0 - 0.4 * (ex * ex + ey * ey) / (r * r);
+            unsigned char* p = &pixels[(y * width + x) * 3];
+            p[0] = static_cast<unsigned char>(230 * shade);
+            p[1] = static_cast<unsigned char>(25 * shade);
+            p[2] = static_cast<unsigned char>(20 * shade);
+        }
+    }
+}
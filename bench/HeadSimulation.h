@@ -0,0 +1,91 @@
+#pragma once
+
+#include "GazeController.h"
+#include <cstddef>
+#include <vector>
+
+// kinematic stand-in for the iCub head: eyes under position or velocity
+// control with a speed limit, neck under velocity control with an
+// acceleration limit, all joints clamped to the simulator's ranges. angles
+// in degrees
+class SimulatedHead {
+public:
+    SimulatedHead();
+    
+    void reset();
+    
+    void positionMoveEyes(double yaw, double tilt);
+    void velocityMoveEyes(double yawVelocity, double tiltVelocity);
+    void positionMoveVergence(double vergence);
+    void velocityMoveNeck(double pitchVelocity, double yawVelocity);
+    
+    // advance the joint dynamics by dt seconds
+    void step(double dt);
+    
+    GazeController::Encoders getEncoders() const;
+    
+    // gaze direction in head-fixed world angles
+    double gazeAzimuth() const { return eyeYaw - neckYaw; }
+    double gazeElevation() const { return eyeTilt + neckPitch; }
+    
+    // eye yaw is version; the left eye turns vergence / 2 further right and
+    // the right eye as far left
+    double getVergence() const { return vergence; }
+    double getNeckYaw() const { return neckYaw; }
+    
+    static constexpr double EYE_SPEED = 60.0;        // degrees/s
+    static constexpr double NECK_ACCELERATION = 400.0;  // degrees/s^2
+    
+private:
+    double eyeYaw, eyeTilt, neckPitch, neckYaw;
+    double eyeYawTarget, eyeTiltTarget;
+    bool eyeVelocityMode;
+    double eyeYawVelocity, eyeTiltVelocity;
+    double vergence, vergenceTarget;
+    double neckPitchVelocity, neckYawVelocity;
+    double neckPitchReference, neckYawReference;
+};
+
+// direction of a jump trial's target, degrees
+struct TargetJump {
+    double azimuth, elevation;
+};
+
+// the seeded target sequence of the synthetic jump trials, shared by
+// replay_bench and gain_tuner so a seed means the same jumps in both. each
+// jump stays inside the field of view of the previous fixation and within
+// the reachable range
+std::vector<TargetJump> makeTargetJumps(unsigned seed, size_t count);
+
+constexpr double MAX_TARGET_AZIMUTH = 30.0;  // degrees, reachable target range
+constexpr double MAX_TARGET_ELEVATION = 15.0;
+
+// renders a red sphere on a static textured background through a pinhole
+// camera looking along the gaze direction
+class SyntheticCamera {
+public:
+    SyntheticCamera(size_t width, size_t height, double horizontalFov = 63.8);
+    
+    // target and gaze directions in degrees, radius as an angle
+    void render(double targetAzimuth, double targetElevation,
+                double gazeAzimuth, double gazeElevation, double radius);
+    
+    // one more sphere on top of the last render
+    void addSphere(double azimuth, double elevation,
+                   double gazeAzimuth, double gazeElevation, double radius);
+    
+    const unsigned char* data() const { return pixels.data(); }
+    unsigned char* data() { return pixels.data(); }
+    size_t getWidth() const { return width; }
+    size_t getHeight() const { return height; }
+    size_t getRowStride() const { return width * 3; }
+    
+    // pixels per radian
+    double getFocalLength() const { return focal; }
+    
+private:
+    size_t width, height;
+    double focal;
+    std::vector<unsigned char> background;
+    std::vector<unsigned char> pixels;
+};
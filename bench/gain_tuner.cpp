@@ -0,0 +1,298 @@
+// batch gain tuning: runs thousands of gain sets through the same seeded
+// target jumps against the simulated head, in parallel and faster than real
+// time, and ranks them by settle time, overshoot and steady-state error.
+// the camera is reduced to the projection of the target centre, so a set
+// costs microseconds per simulated tick instead of a rendered frame
+//
+// usage: gain_tuner [--sets 2000] [--span 4] [--base <gains file>] [--seed 1]
+//                   [--jumps 8] [--timeout 5] [--hold 1] [--workers 0]
+//                   [--period 0.02] [--latency 0.04] [--predict 1]
+//                   [--eyes position|velocity] [--inner_period 0.005]
+//                   [--w_overshoot 0.2] [--w_steady 2] [--top 10]
+//                   [--out <gains file>]
+
+#include "BenchOptions.h"
+#include "GazeController.h"
+#include "HeadSimulation.h"
+#include "TargetPredictor.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double SETTLE_ERROR = 1.0;  // degrees between gaze and target
+constexpr double WIDTH = 320.0, HEIGHT = 240.0;
+constexpr double FOV = 63.8;
+constexpr double DEG = M_PI / 180.0;
+
+struct Scenario {
+    std::vector<TargetJump> jumps;  // replay_bench's synthetic run for the same seed
+    double period, timeout, hold;
+    size_t delayTicks;
+    bool predict;
+    EyeControlMode mode;
+    size_t innerSteps;  // joint ticks per frame
+};
+
+struct Score {
+    GazeGains gains;
+    int settled = 0;
+    double settle = 0.0;     // mean seconds, a timeout counts as the timeout
+    double overshoot = 0.0;  // mean degrees past the target along each jump
+    double steady = 0.0;     // mean rms degrees over the hold after settling
+    double cost = 0.0;
+    double simulated = 0.0;  // seconds
+};
+
+// detection of the target centre: the pixel offset a perfect detector would
+// report, or nothing once the centre leaves the frame
+struct Detection {
+    bool found;
+    int x, y;
+};
+
+Detection project(double targetAz, double targetEl, double gazeAz, double gazeEl, double focal) {
+    const double dx = (targetAz - gazeAz) * DEG;
+    const double dy = (targetEl - gazeEl) * DEG;
+    if (std::abs(dx) >= M_PI / 2 || std::abs(dy) >= M_PI / 2) return {false, 0, 0};
+    
+    const double x = focal * std::tan(dx);
+    const double y = -focal * std::tan(dy);  // image y points down
+    if (std::abs(x) >= WIDTH / 2 || std::abs(y) >= HEIGHT / 2) return {false, 0, 0};
+    return {true, static_cast<int>(std::lround(x)), static_cast<int>(std::lround(y))};
+}
+
+// one gain set through every jump of the scenario, the loop of replay_bench
+// with the camera and detector replaced by the projection
+Score evaluate(const GazeGains& gains, const Scenario& scenario) {
+    const double focal = WIDTH / (2.0 * std::tan(FOV * DEG / 2.0));
+    SimulatedHead head;
+    GazeController controller;
+    controller.setMode(scenario.mode);
+    controller.setGains(gains);
+    TargetPredictor predictor(FOV);
+    std::deque<std::pair<double, Detection>> inFlight;  // capture time and detection
+    
+    Score score;
+    score.gains = gains;
+    double clock = 0.0;
+    bool tracking = false;
+    
+    for (const TargetJump& jump : scenario.jumps) {
+        // overshoot is measured along the line from the gaze at the jump
+        const double startAz = head.gazeAzimuth(), startEl = head.gazeElevation();
+        const double length = std::hypot(jump.azimuth - startAz, jump.elevation - startEl);
+        const double dirAz = length > 0.0 ? (jump.azimuth - startAz) / length : 0.0;
+        const double dirEl = length > 0.0 ? (jump.elevation - startEl) / length : 0.0;
+        
+        double settledAt = -1.0, overshoot = 0.0, squared = 0.0;
+        size_t holdTicks = 0;
+        double t = 0.0;
+        for (; t < scenario.timeout + scenario.hold; t += scenario.period, clock += scenario.period) {
+            if (settledAt < 0.0 && t >= scenario.timeout) break;
+            if (settledAt >= 0.0 && t >= settledAt + scenario.hold) break;
+            
+            const GazeController::Encoders encoders = head.getEncoders();
+            inFlight.emplace_back(clock, project(jump.azimuth, jump.elevation,
+                                                 head.gazeAzimuth(), head.gazeElevation(), focal));
+            predictor.recordHead(clock, encoders);
+            
+            bool measured = false;
+            const bool arrived = inFlight.size() > scenario.delayTicks;
+            if (arrived) {
+                const Detection detection = inFlight.front().second;
+                measured = detection.found;
+                if (measured && scenario.predict) {
+                    predictor.measure(inFlight.front().first, detection.x, detection.y, static_cast<size_t>(WIDTH));
+                } else if (measured) {
+                    controller.updateError(detection.x, detection.y);
+                }
+                inFlight.pop_front();
+            }
+            
+            // a miss ends tracking as in gaze_control and the head stops
+            if (tracking && !measured && (scenario.predict ? !predictor.isTracking(clock) : arrived)) {
+                tracking = false;
+                head.velocityMoveNeck(0.0, 0.0);
+                if (scenario.mode == EyeControlMode::Velocity) head.velocityMoveEyes(0.0, 0.0);
+            }
+            tracking = tracking || measured;
+            
+            bool active = measured;
+            if (scenario.predict && (measured || scenario.mode == EyeControlMode::Position)) {
+                double errorX, errorY;
+                active = predictor.predictError(clock + scenario.period / scenario.innerSteps, encoders, errorX, errorY);
+                if (active) {
+                    controller.updateError(static_cast<int>(std::lround(errorX)), static_cast<int>(std::lround(errorY)));
+                }
+            }
+            for (size_t inner = 0; inner < scenario.innerSteps; inner++) {
+                if (tracking) {
+                    const GazeController::Command command = controller.step(inner ? head.getEncoders() : encoders,
+                                                                             active && inner == 0);
+                    if (command.moveEyes) head.positionMoveEyes(command.eyeYaw, command.eyeTilt);
+                    if (command.moveEyeVelocity) head.velocityMoveEyes(command.eyeYawVelocity, command.eyeTiltVelocity);
+                    head.velocityMoveNeck(command.neckPitchVelocity, command.neckYawVelocity);
+                }
+                head.step(scenario.period / scenario.innerSteps);
+            }
+            
+            const double errorAz = head.gazeAzimuth() - jump.azimuth;
+            const double errorEl = head.gazeElevation() - jump.elevation;
+            const double error = std::hypot(errorAz, errorEl);
+            overshoot = std::max(overshoot, errorAz * dirAz + errorEl * dirEl);
+            if (settledAt >= 0.0) {
+                squared += error * error;
+                holdTicks++;
+            } else if (measured && error < SETTLE_ERROR && controller.isConverged(head.getEncoders())) {
+                settledAt = t;
+            }
+        }
+        
+        if (settledAt >= 0.0) {
+            score.settled++;
+            score.settle += settledAt;
+            score.steady += holdTicks ? std::sqrt(squared / holdTicks) : 0.0;
+        } else {
+            score.settle += scenario.timeout;
+            score.steady += std::hypot(head.gazeAzimuth() - jump.azimuth, head.gazeElevation() - jump.elevation);
+        }
+        score.overshoot += overshoot;
+    }
+    
+    const double jumps = static_cast<double>(scenario.jumps.size());
+    score.simulated = clock;
+    score.settle /= jumps;
+    score.overshoot /= jumps;
+    score.steady /= jumps;
+    return score;
+}
+
+// gains spread log-uniformly over base / span to base * span; set 0 is the base
+std::vector<GazeGains> sampleGains(const GazeGains& base, size_t count, double span, unsigned seed) {
+    std::mt19937 rng(seed + 300);
+    std::uniform_real_distribution<double> exponent(-1.0, 1.0);
+    auto spread = [&](double value) { return value * std::pow(span, exponent(rng)); };
+    
+    std::vector<GazeGains> sets(1, base);
+    while (sets.size() < count) {
+        GazeGains gains = base;
+        gains.kp = spread(base.kp);
+        gains.ki = spread(base.ki);
+        gains.kd = spread(base.kd);
+        gains.headGain = spread(base.headGain);
+        gains.maxIntegral = spread(base.maxIntegral);
+        sets.push_back(gains);
+    }
+    return sets;
+}
+
+void printScore(size_t rank, const Score& score, size_t jumps) {
+    std::printf("%5zu %7.4f %7.4f %7.4f %7.3f %7.2f %4d/%-3zu %8.2f %8.2f %8.3f %8.3f\n", rank,
+                score.gains.kp, score.gains.ki, score.gains.kd, score.gains.headGain, score.gains.maxIntegral,
+                score.settled, jumps, score.settle, score.overshoot, score.steady, score.cost);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv,
+                      {"sets", "span", "seed", "jumps", "timeout", "hold", "workers", "period", "latency",
+                       "predict", "inner_period", "w_overshoot", "w_steady", "top"},
+                      {"base", "eyes", "out"}, options)) {
+        return 1;
+    }
+    const unsigned seed = static_cast<unsigned>(options.get("seed", 1));
+    
+    GazeGains base;
+    if (!options.getString("base").empty()) {
+        std::string error;
+        if (!base.load(options.getString("base"), error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+    }
+    
+    Scenario scenario;
+    scenario.jumps = makeTargetJumps(seed, static_cast<size_t>(std::max(0.0, options.get("jumps", 8))));
+    scenario.period = options.get("period", 0.02);
+    scenario.timeout = options.get("timeout", 5.0);
+    scenario.hold = options.get("hold", 1.0);
+    scenario.delayTicks = static_cast<size_t>(std::lround(options.get("latency", 0.04) / scenario.period));
+    scenario.predict = options.get("predict", 1) != 0;
+    scenario.mode = EyeControlMode::Position;
+    scenario.innerSteps = 1;
+    if (!options.getString("eyes").empty() && !parseEyeControlMode(options.getString("eyes"), scenario.mode)) {
+        std::fprintf(stderr, "unknown eye control mode %s\n", options.getString("eyes").c_str());
+        return 1;
+    }
+    if (scenario.mode == EyeControlMode::Velocity) {
+        scenario.innerSteps = std::max<size_t>(1, static_cast<size_t>(
+            std::lround(scenario.period / options.get("inner_period", 0.005))));
+    }
+    
+    const size_t count = static_cast<size_t>(std::max(1.0, options.get("sets", 2000)));
+    const std::vector<GazeGains> sets = sampleGains(base, count, std::max(1.0, options.get("span", 4.0)), seed);
+    const double overshootWeight = options.get("w_overshoot", 0.2);  // seconds per degree
+    const double steadyWeight = options.get("w_steady", 2.0);        // seconds per degree
+    
+    WorkerPool pool(static_cast<size_t>(std::max(0.0, options.get("workers", 0))));
+    std::printf("%zu gain sets, %zu jumps each, period %.3f s, latency %zu periods, prediction %s, %s eyes, %zu threads\n",
+                sets.size(), scenario.jumps.size(), scenario.period, scenario.delayTicks,
+                scenario.predict ? "on" : "off", eyeControlModeName(scenario.mode), pool.size());
+    
+    // every set is independent; the pool hands them out one at a time
+    std::vector<Score> scores(sets.size());
+    const Clock::time_point start = Clock::now();
+    pool.parallelFor(sets.size(), [&](size_t i) {
+        Score score = evaluate(sets[i], scenario);
+        score.cost = score.settle + overshootWeight * score.overshoot + steadyWeight * score.steady;
+        scores[i] = score;
+    });
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    double simulated = 0.0;
+    for (const Score& score : scores) simulated += score.simulated;
+    std::printf("evaluated in %.2f s, %.0f sets/s, %.0fx real time\n", elapsed, sets.size() / elapsed,
+                simulated / elapsed);
+    
+    // jumps that never settle rank below any cost
+    const Score baseline = scores[0];
+    std::vector<size_t> order(scores.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (scores[a].settled != scores[b].settled) return scores[a].settled > scores[b].settled;
+        return scores[a].cost < scores[b].cost;
+    });
+    
+    std::printf("%5s %7s %7s %7s %7s %7s %8s %8s %8s %8s %8s\n", "rank", "kp", "ki", "kd", "head",
+                "maxint", "settled", "settle s", "over deg", "rms deg", "cost");
+    const size_t top = std::min(order.size(), static_cast<size_t>(std::max(1.0, options.get("top", 10))));
+    for (size_t rank = 0; rank < top; rank++) {
+        printScore(rank + 1, scores[order[rank]], scenario.jumps.size());
+    }
+    const size_t baseRank = static_cast<size_t>(std::find(order.begin(), order.end(), 0) - order.begin());
+    std::printf("base:\n");
+    printScore(baseRank + 1, baseline, scenario.jumps.size());
+    
+    if (!options.getString("out").empty()) {
+        std::string error;
+        if (!scores[order[0]].gains.save(options.getString("out"), error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        std::printf("best gains written to %s\n", options.getString("out").c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+// start jitter and worst-case tick time of a 50 Hz loop doing a frame's
+// segmentation while other threads load every cpu and churn memory, with
+// and without real-time scheduling, pinning and locked memory.
+// usage: jitter_bench [--sched other|fifo|rr] [--priority N] [--cpus LIST]
+//                     [--mlock 0|1] [--load N] [--seconds S] [--period S]
+
+#include "BenchOptions.h"
+#include "LoopStatistics.h"
+#include "RealtimeConfig.h"
+#include "Segmentation.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t WIDTH = 320, HEIGHT = 240;  // the simulator camera
+constexpr size_t CHURN_BYTES = 8 << 20;      // allocated and touched per load iteration
+
+// spins and allocates fresh pages, so the loop competes for cpu, cache and
+// the page allocator
+void loadLoop(const std::atomic<bool>& stop) {
+    while (!stop.load(std::memory_order_relaxed)) {
+        std::vector<unsigned char> churn(CHURN_BYTES);
+        for (size_t i = 0; i < churn.size(); i += 64) churn[i] = static_cast<unsigned char>(i);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, {"priority", "mlock", "load", "seconds", "period"}, {"sched", "cpus"}, options)) {
+        return 1;
+    }
+    const double period = options.get("period", 0.02);
+    const double seconds = options.get("seconds", 10.0);
+    const int loadThreads = static_cast<int>(options.get("load", std::thread::hardware_concurrency()));
+    
+    ThreadSchedule schedule;
+    std::string error;
+    const std::string policy = options.getString("sched", "other");
+    if (!parseSchedulePolicy(policy, schedule.policy)) {
+        std::fprintf(stderr, "unknown scheduling policy %s\n", policy.c_str());
+        return 1;
+    }
+    schedule.priority = static_cast<int>(options.get("priority", 80));
+    const std::string cpus = options.getString("cpus", "");
+    if (!cpus.empty() && !parseCpuList(cpus, schedule.cpus, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    
+    // a frame with a red disc, segmented every tick like a vision update
+    std::vector<unsigned char> frame(WIDTH * HEIGHT * 3);
+    std::mt19937 rng(3);
+    for (size_t i = 0; i < frame.size(); i++) frame[i] = static_cast<unsigned char>(rng() % 200);
+    Region region;
+    region.x1 = WIDTH;
+    region.y1 = HEIGHT;
+    
+    // the load starts first: threads inherit their creator's scheduling
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> load;
+    for (int i = 0; i < loadThreads; i++) load.emplace_back(loadLoop, std::cref(stop));
+    
+    const bool ok = (options.get("mlock", 0) == 0 || lockProcessMemory(error)) &&
+                    applyThreadSchedule(schedule, error);
+    if (!ok) {
+        stop = true;
+        for (std::thread& thread : load) thread.join();
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    prefaultStack();
+    
+    std::printf("loop %s, %s memory, %d load threads, %.0f s at %.0f Hz\n",
+                schedule.describe().c_str(), options.get("mlock", 0) != 0 ? "locked" : "unlocked",
+                loadThreads, seconds, 1.0 / period);
+    
+    LoopStatistics stats(period);
+    const auto step = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(period));
+    auto wake = std::chrono::steady_clock::now() + step;
+    const size_t ticks = static_cast<size_t>(seconds / period);
+    uint64_t found = 0;
+    for (size_t i = 0; i < ticks; i++) {
+        std::this_thread::sleep_until(wake);
+        wake += step;
+        stats.recordStart();
+        
+        const auto start = std::chrono::steady_clock::now();
+        found += segmentRed(frame.data(), WIDTH * 3, region).count;
+        TelemetrySample sample = TelemetrySample();
+        sample.stageTime[STAGE_SEGMENT] = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+        sample.tickTime = sample.stageTime[STAGE_SEGMENT];
+        stats.record(sample);
+    }
+    
+    stop = true;
+    for (std::thread& thread : load) thread.join();
+    std::printf("%s", stats.report().c_str());
+    return found > 0 ? 0 : 1;
+}
@@ -0,0 +1,579 @@
+// headless replay harness: drives the segmentation and pid code of the gaze
+// controller against a simulated head, with no yarp network or simulator.
+//
+// usage: replay_bench [--width 320] [--height 240] [--jumps 10] [--seed 1]
+//                     [--workers 1] [--roi 1] [--period 0.02] [--timeout 10]
+//                     [--latency 0.04] [--predict 1] [--lead <control period>]
+//                     [--pursuit <peak deg/s>] [--duration 20]
+//                     [--motion lissajous|sweep|sine|walk]
+//                     [--target largest|nearest|tracked|centroid] [--distractors 0]
+//                     [--classifier <rules file>] [--gains <gains file>] [--stereo 0|1]
+//                     [--incremental 0|1] [--hold 0]
+//                     [--eyes position|velocity] [--inner_period 0.005]
+//                     [--replay <dir of .ppm frames>] [--session <session log>]
+
+#include "BenchOptions.h"
+#include "FramePool.h"
+#include "GazeController.h"
+#include "HeadSimulation.h"
+#include "LatencyHistogram.h"
+#include "SessionLog.h"
+#include "StereoVision.h"
+#include "TargetDetector.h"
+#include "TargetPredictor.h"
+#include "TargetTrajectory.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double TARGET_RADIUS = 2.9;  // degrees, the 4 cm sphere at 0.8 m
+constexpr double SETTLE_ERROR = 1.0;       // degrees between gaze and target
+constexpr double DISTRACTOR_RADIUS = 1.5;  // degrees, smaller red objects in the scene
+constexpr double SPHERE_RADIUS = 0.04;     // metres, the same sphere placed at distance in stereo
+constexpr double MIN_DISTANCE = 0.3, MAX_DISTANCE = 0.8;  // metres, stereo targets, never smaller than mono
+constexpr double SETTLE_VERGENCE = 1.0;    // degrees between vergence and the target's
+constexpr double DEG = M_PI / 180.0;
+
+// one detection plus pid update, the work GazeThread does on a fresh frame.
+// with a predictor the detection only feeds the filter and the pid runs on
+// the predicted error in tick()
+struct Pipeline {
+    TargetDetector detector;
+    GazeController controller;
+    TargetPredictor predictor;
+    LatencyHistogram latency;
+    bool predict = false;
+    double busy = 0.0;
+    size_t frames = 0;
+    
+    // stereo: a right-eye detector with its own pool, run alongside the left
+    std::unique_ptr<WorkerPool> rightPool;
+    std::unique_ptr<TargetDetector> rightDetector;
+    std::unique_ptr<StereoDetector> stereo;
+    StereoGeometry geometry;
+    StereoDetection stereoDetection;
+    StereoTarget fix{0.0, 0.0, 0.0, 0.0, 0.0};  // last triangulation
+    
+    Pipeline(WorkerPool& pool, bool roi, TargetPolicy policy = TargetPolicy::Largest) :
+        detector(pool, roi, policy) {}
+    
+    void enableStereo(size_t lanes) {
+        rightPool.reset(new WorkerPool(lanes));
+        rightDetector.reset(new TargetDetector(*rightPool, detector.isRoiTracking(), detector.getPolicy()));
+        rightDetector->setIncremental(detector.isIncremental());
+        stereo.reset(new StereoDetector(detector, *rightDetector));
+    }
+    
+    bool loadClassifier(const Options& options) {
+        if (options.getString("classifier").empty()) return true;
+        
+        ColorClassifier classifier;
+        std::string error;
+        if (!classifier.load(options.getString("classifier"), error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return false;
+        }
+        detector.setClassifier(classifier);
+        if (rightDetector) rightDetector->setClassifier(classifier);
+        return true;
+    }
+    
+    bool loadGains(const Options& options) {
+        if (options.getString("gains").empty()) return true;
+        
+        GazeGains gains;
+        std::string error;
+        if (!gains.load(options.getString("gains"), error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return false;
+        }
+        controller.setGains(gains);
+        return true;
+    }
+    
+    bool process(const unsigned char* data, size_t rowStride, size_t width, size_t height,
+                 double captureTime = 0.0) {
+        const Clock::time_point start = Clock::now();
+        
+        SegmentMoments moments;
+        const bool found = detector.detect(data, rowStride, width, height, moments);
+        if (found) {
+            const int x = static_cast<int>(moments.sumX / moments.count) - static_cast<int>(width / 2);
+            const int y = static_cast<int>(moments.sumY / moments.count) - static_cast<int>(height / 2);
+            if (predict) {
+                predictor.measure(captureTime, x, y, width);
+            } else {
+                controller.updateError(x, y);
+            }
+        }
+        
+        const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        latency.record(elapsed);
+        busy += elapsed;
+        frames++;
+        return found;
+    }
+    
+    // both eyes at once; version runs on the cyclopean error
+    bool processStereo(const FrameRef& left, const FrameRef& right, double captureTime) {
+        const Clock::time_point start = Clock::now();
+        
+        stereoDetection = stereo->detect(left, right);
+        double x, y;
+        const bool found = stereoDetection.cyclopean(x, y);
+        if (found && predict) {
+            predictor.measure(captureTime, x, y, left.width());
+        } else if (found) {
+            controller.updateError(static_cast<int>(std::lround(x)), static_cast<int>(std::lround(y)));
+        }
+        
+        const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        latency.record(elapsed);
+        busy += elapsed;
+        frames++;
+        return found;
+    }
+    
+    // vergence from the last stereo detection and the current eye pose
+    void verge(const GazeController::Encoders& encoders, double vergence, size_t width) {
+        if (geometry.triangulate(stereoDetection, width, encoders.eyeYaw, vergence, encoders.eyeTilt, fix)) {
+            controller.updateVergence(fix.vergence);
+        }
+    }
+    
+    // pid input for this tick; true when the eyes get a new target
+    bool tick(double time, double lead, const GazeController::Encoders& encoders, bool measured) {
+        if (!predict) return measured;
+        if (!measured && controller.getMode() == EyeControlMode::Velocity) return false;  // as the controller
+        
+        double errorX, errorY;
+        if (!predictor.predictError(time + lead, encoders, errorX, errorY)) return false;
+        controller.updateError(static_cast<int>(std::lround(errorX)), static_cast<int>(std::lround(errorY)));
+        return true;
+    }
+    
+    void report() const {
+        std::printf("frames: %zu, %.0f frames/s, %llu answered without segmenting\n", frames,
+                    busy > 0.0 ? frames / busy : 0.0, static_cast<unsigned long long>(detector.getReusedFrames()));
+        std::printf("per-frame latency us: p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+                    latency.percentile(0.5) * 1e6, latency.percentile(0.99) * 1e6,
+                    latency.percentile(0.999) * 1e6, latency.max() * 1e6);
+    }
+};
+
+// simulated head and camera in closed loop; frames reach the pipeline a
+// fixed number of control periods after capture, like the camera port.
+// in stereo the camera is the left eye, the target sits at distance and
+// each eye sees it from its own end of the baseline
+struct ClosedLoop {
+    SyntheticCamera camera;
+    std::unique_ptr<SyntheticCamera> rightCamera;  // only in stereo
+    SimulatedHead head;
+    Pipeline pipeline;
+    double period, lead;
+    size_t delayTicks;
+    size_t innerSteps = 1;  // joint ticks per frame, more than one in velocity mode
+    bool tracking = false;
+    std::vector<std::pair<double, double>> distractors;  // fixed directions, degrees
+    
+    double distance = 0.8;        // metres, stereo only
+    double targetVergence = 0.0;  // degrees that fixate the target, stereo only
+    
+    FramePool frames;  // one slab per frame in flight plus the one being rendered, per eye
+    std::deque<FrameRef> inFlight, rightInFlight;
+    
+    ClosedLoop(const Options& options, WorkerPool& pool) :
+        camera(static_cast<size_t>(options.get("width", 320)), static_cast<size_t>(options.get("height", 240))),
+        pipeline(pool, options.get("roi", 1) != 0, policyOption(options)),
+        period(options.get("period", 0.02)),
+        lead(period),
+        delayTicks(static_cast<size_t>(std::lround(options.get("latency", 0.04) / period))),
+        frames(2 * (delayTicks + 2), camera.getWidth(), camera.getHeight()) {
+        pipeline.predict = options.get("predict", 1) != 0;
+        pipeline.detector.setIncremental(options.get("incremental", 0) != 0);
+        pipeline.controller.setMode(eyeModeOption(options));
+        if (pipeline.controller.getMode() == EyeControlMode::Velocity) {
+            innerSteps = std::max<size_t>(1, static_cast<size_t>(std::lround(period / options.get("inner_period", 0.005))));
+        }
+        lead = options.get("lead", period / innerSteps);  // one control tick, as gaze_control
+        if (options.get("stereo", 0) != 0) {
+            rightCamera.reset(new SyntheticCamera(camera.getWidth(), camera.getHeight()));
+            pipeline.enableStereo(pool.size());
+        }
+        
+        // clutter scattered over the reachable range, away from the start
+        std::mt19937 rng(static_cast<unsigned>(options.get("seed", 1)) + 100);
+        std::uniform_real_distribution<double> azimuth(-MAX_TARGET_AZIMUTH - 10.0, MAX_TARGET_AZIMUTH + 10.0);
+        std::uniform_real_distribution<double> elevation(-MAX_TARGET_ELEVATION - 10.0, MAX_TARGET_ELEVATION + 10.0);
+        for (int i = 0; i < static_cast<int>(options.get("distractors", 0)); i++) {
+            distractors.emplace_back(azimuth(rng), elevation(rng));
+        }
+    }
+    
+    static TargetPolicy policyOption(const Options& options) {
+        TargetPolicy policy = TargetPolicy::Largest;
+        const std::string name = options.getString("target");
+        if (!name.empty() && !parseTargetPolicy(name, policy)) {
+            std::fprintf(stderr, "unknown target policy %s, using largest\n", name.c_str());
+        }
+        return policy;
+    }
+    
+    static EyeControlMode eyeModeOption(const Options& options) {
+        EyeControlMode mode = EyeControlMode::Position;
+        const std::string name = options.getString("eyes");
+        if (!name.empty() && !parseEyeControlMode(name, mode)) {
+            std::fprintf(stderr, "unknown eye control mode %s, using position\n", name.c_str());
+        }
+        return mode;
+    }
+    
+    bool isStereo() const { return rightCamera != nullptr; }
+    
+    void apply(const GazeController::Command& command) {
+        if (command.moveEyes) head.positionMoveEyes(command.eyeYaw, command.eyeTilt);
+        if (command.moveEyeVelocity) head.velocityMoveEyes(command.eyeYawVelocity, command.eyeTiltVelocity);
+        if (command.moveVergence) head.positionMoveVergence(command.eyeVergence);
+        head.velocityMoveNeck(command.neckPitchVelocity, command.neckYawVelocity);
+    }
+    
+    // the target from one eye, side -1 for the left and +1 for the right;
+    // returns the azimuth of that eye's ray to the target
+    double renderEye(SyntheticCamera& eye, double side, double targetAz, double targetEl) {
+        // eye centre on the baseline, which turns with the neck
+        const double headYaw = -head.getNeckYaw() * DEG;
+        const double eyeX = side * StereoGeometry::BASELINE / 2.0 * std::cos(headYaw);
+        const double eyeZ = -side * StereoGeometry::BASELINE / 2.0 * std::sin(headYaw);
+        
+        const double dx = distance * std::cos(targetEl * DEG) * std::sin(targetAz * DEG) - eyeX;
+        const double dy = distance * std::sin(targetEl * DEG);
+        const double dz = distance * std::cos(targetEl * DEG) * std::cos(targetAz * DEG) - eyeZ;
+        const double range = std::sqrt(dx * dx + dy * dy + dz * dz);
+        const double azimuth = std::atan2(dx, dz) / DEG;
+        
+        const double gazeAz = head.gazeAzimuth() - side * head.getVergence() / 2.0;
+        eye.render(azimuth, std::atan2(dy, std::hypot(dx, dz)) / DEG, gazeAz, head.gazeElevation(),
+                   std::atan(SPHERE_RADIUS / range) / DEG);
+        for (const auto& distractor : distractors) {
+            eye.addSphere(distractor.first, distractor.second, gazeAz, head.gazeElevation(), DISTRACTOR_RADIUS);
+        }
+        return azimuth;
+    }
+    
+    void capture(const SyntheticCamera& eye, double t, std::deque<FrameRef>& queue) {
+        FrameRef frame = frames.acquire(eye.getWidth(), eye.getHeight());
+        std::memcpy(frame.data(), eye.data(), eye.getRowStride() * eye.getHeight());
+        frame.setTimestamp(t, true);
+        queue.push_back(std::move(frame));
+    }
+    
+    void stopHead() {
+        head.velocityMoveNeck(0.0, 0.0);
+        if (pipeline.controller.getMode() == EyeControlMode::Velocity) head.velocityMoveEyes(0.0, 0.0);
+    }
+    
+    // one control period at time t; true when a frame had the target
+    bool step(double t, double targetAz, double targetEl) {
+        if (isStereo()) {
+            targetVergence = renderEye(camera, -1.0, targetAz, targetEl) -
+                             renderEye(*rightCamera, 1.0, targetAz, targetEl);
+            capture(*rightCamera, t, rightInFlight);
+        } else {
+            camera.render(targetAz, targetEl, head.gazeAzimuth(), head.gazeElevation(), TARGET_RADIUS);
+            for (const auto& distractor : distractors) {
+                camera.addSphere(distractor.first, distractor.second,
+                                 head.gazeAzimuth(), head.gazeElevation(), DISTRACTOR_RADIUS);
+            }
+        }
+        capture(camera, t, inFlight);
+        
+        const GazeController::Encoders encoders = head.getEncoders();
+        pipeline.predictor.recordHead(t, encoders);
+        
+        bool measured = false;
+        const bool arrived = inFlight.size() > delayTicks;
+        if (arrived) {
+            const FrameRef& frame = inFlight.front();
+            if (isStereo()) {
+                measured = pipeline.processStereo(frame, rightInFlight.front(), frame.timestamp());
+                if (measured) pipeline.verge(encoders, head.getVergence(), frame.width());
+                rightInFlight.pop_front();
+            } else {
+                measured = pipeline.process(frame.data(), frame.rowStride(),
+                                            frame.width(), frame.height(), frame.timestamp());
+            }
+            inFlight.pop_front();
+        }
+        
+        // a miss ends tracking as in gaze_control, with prediction once the
+        // filter stops coasting, and the head stops
+        if (tracking && !measured && (pipeline.predict ? !pipeline.predictor.isTracking(t) : arrived)) {
+            tracking = false;
+            stopHead();
+        }
+        tracking = tracking || measured;
+        
+        const bool active = pipeline.tick(t, lead, encoders, measured);
+        if (tracking) apply(pipeline.controller.step(encoders, active));
+        head.step(period / innerSteps);
+        
+        // velocity mode: the joint loop runs on between frames, on encoders alone
+        for (size_t inner = 1; inner < innerSteps; inner++) {
+            if (tracking) apply(pipeline.controller.step(head.getEncoders(), false));
+            head.step(period / innerSteps);
+        }
+        return measured;
+    }
+};
+
+// closed loop: render, detect, control, advance the head; simulated time
+int runSynthetic(const Options& options, WorkerPool& pool) {
+    const std::vector<TargetJump> jumps =
+        makeTargetJumps(static_cast<unsigned>(options.get("seed", 1)),
+                        static_cast<size_t>(std::max(0.0, options.get("jumps", 10))));
+    const double timeout = options.get("timeout", 10.0);
+    const double hold = options.get("hold", 0.0);  // fixation after each settle, as --dwell does
+    
+    ClosedLoop loop(options, pool);
+    if (!loop.pipeline.loadClassifier(options) || !loop.pipeline.loadGains(options)) return 1;
+    
+    // stereo targets also jump in depth, from a generator of their own so
+    // the direction sequence matches mono runs
+    std::mt19937 depthRng(static_cast<unsigned>(options.get("seed", 1)) + 200);
+    std::uniform_real_distribution<double> depthJump(MIN_DISTANCE, MAX_DISTANCE);
+    
+    std::printf("synthetic %zux%zu%s, %zu jumps, period %.3f s, latency %zu periods, prediction %s, "
+                "target %s, %zu distractors, %s eyes\n",
+                loop.camera.getWidth(), loop.camera.getHeight(), loop.isStereo() ? " stereo" : "",
+                jumps.size(), loop.period, loop.delayTicks, loop.pipeline.predict ? "on" : "off",
+                targetPolicyName(loop.pipeline.detector.getPolicy()), loop.distractors.size(),
+                eyeControlModeName(loop.pipeline.controller.getMode()));
+    if (loop.isStereo()) {
+        std::printf("%5s %9s %9s %9s %12s %12s\n", "jump", "az deg", "el deg", "dist m", "settle s", "depth err m");
+    } else {
+        std::printf("%5s %9s %9s %12s\n", "jump", "az deg", "el deg", "settle s");
+    }
+    
+    int converged = 0;
+    double totalSettle = 0.0;
+    double clock = 0.0;
+    
+    for (size_t jump = 0; jump < jumps.size(); jump++) {
+        const double targetAz = jumps[jump].azimuth, targetEl = jumps[jump].elevation;
+        if (loop.isStereo()) loop.distance = depthJump(depthRng);
+        
+        double t = 0.0;
+        bool settled = false;
+        for (; t < timeout; t += loop.period, clock += loop.period) {
+            const bool measured = loop.step(clock, targetAz, targetEl);
+            const double error = std::hypot(targetAz - loop.head.gazeAzimuth(),
+                                            targetEl - loop.head.gazeElevation());
+            
+            // converged on the target, not on whatever the detector picked
+            const bool verged = !loop.isStereo() ||
+                                std::abs(loop.head.getVergence() - loop.targetVergence) < SETTLE_VERGENCE;
+            if (measured && error < SETTLE_ERROR && verged &&
+                loop.pipeline.controller.isConverged(loop.head.getEncoders())) {
+                settled = true;
+                break;
+            }
+        }
+        for (double held = 0.0; settled && held < hold; held += loop.period, clock += loop.period) {
+            loop.step(clock, targetAz, targetEl);
+        }
+        
+        if (settled && loop.isStereo()) {
+            converged++;
+            totalSettle += t;
+            std::printf("%5zu %9.2f %9.2f %9.2f %12.2f %12.3f\n", jump + 1, targetAz, targetEl,
+                        loop.distance, t, std::abs(loop.pipeline.fix.distance - loop.distance));
+        } else if (settled) {
+            converged++;
+            totalSettle += t;
+            std::printf("%5zu %9.2f %9.2f %12.2f\n", jump + 1, targetAz, targetEl, t);
+        } else {
+            std::printf("%5zu %9.2f %9.2f %12s\n", jump + 1, targetAz, targetEl, "timeout");
+        }
+    }
+    
+    std::printf("converged %d of %zu", converged, jumps.size());
+    if (converged) std::printf(", mean settle %.2f s", totalSettle / converged);
+    std::printf("\n");
+    loop.pipeline.report();
+    return static_cast<size_t>(converged) == jumps.size() ? 0 : 2;
+}
+
+// closed loop on a moving target at the given speed, a lissajous path unless
+// --motion says otherwise; reports the angular gaze error once the pursuit
+// has started. the same seed gives the same path, as in the controller
+int runPursuit(const Options& options, WorkerPool& pool) {
+    TrajectorySettings motion;
+    const std::string kind = options.getString("motion");
+    if (!kind.empty() && (!parseTrajectoryKind(kind, motion.kind) || motion.kind == TrajectoryKind::Jumps)) {
+        std::fprintf(stderr, "unknown motion %s\n", kind.c_str());
+        return 1;
+    }
+    motion.seed = static_cast<unsigned>(options.get("seed", 1));
+    motion.amplitudeX = 15.0;  // degrees of azimuth, elevation swings half as far
+    motion.amplitudeY = 7.5;
+    motion.speed = options.get("pursuit", 20.0);
+    const double duration = options.get("duration", 20.0);
+    TargetTrajectory trajectory(motion);
+    
+    ClosedLoop loop(options, pool);
+    if (!loop.pipeline.loadClassifier(options) || !loop.pipeline.loadGains(options)) return 1;
+    std::printf("pursuit %s at %.1f deg/s, latency %zu periods, prediction %s\n", trajectoryKindName(motion.kind),
+                motion.speed, loop.delayTicks, loop.pipeline.predict ? "on" : "off");
+    
+    LatencyHistogram error;  // degrees, kept in the histogram's seconds
+    double squared = 0.0;
+    size_t samples = 0, lost = 0;
+    for (double t = 0.0; t < duration; t += loop.period) {
+        double targetAz, targetEl;
+        trajectory.at(t, targetAz, targetEl);
+        const bool measured = loop.step(t, targetAz, targetEl);
+        if (t < 2.0) continue;  // initial acquisition
+        
+        const double e = std::hypot(targetAz - loop.head.gazeAzimuth(), targetEl - loop.head.gazeElevation());
+        error.record(e);
+        squared += e * e;
+        samples++;
+        lost += measured ? 0 : 1;
+    }
+    
+    std::printf("gaze error deg: rms %.2f  p50 %.2f  p99 %.2f  max %.2f, %zu of %zu frames without target\n",
+                samples ? std::sqrt(squared / samples) : 0.0, error.percentile(0.5),
+                error.percentile(0.99), error.max(), lost, samples);
+    loop.pipeline.report();
+    return 0;
+}
+
+// binary ppm (P6, maxval 255) into an interleaved rgb buffer
+bool loadPpm(const std::string& path, std::vector<unsigned char>& pixels, size_t& width, size_t& height) {
+    std::ifstream file(path, std::ios::binary);
+    std::string magic;
+    int maxValue = 0;
+    file >> magic >> width >> height >> maxValue;
+    file.get();
+    if (!file || magic != "P6" || maxValue != 255) return false;
+    
+    pixels.resize(width * height * 3);
+    file.read(reinterpret_cast<char*>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+    return static_cast<bool>(file);
+}
+
+// open loop over recorded frames, repeated until enough samples are taken
+int runReplay(const Options& options, WorkerPool& pool) {
+    std::vector<std::string> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(options.getString("replay"))) {
+        if (entry.path().extension() == ".ppm") paths.push_back(entry.path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+    
+    struct Frame {
+        std::vector<unsigned char> pixels;
+        size_t width = 0, height = 0;
+    };
+    std::vector<Frame> frames;
+    for (const std::string& path : paths) {
+        Frame frame;
+        if (!loadPpm(path, frame.pixels, frame.width, frame.height)) {
+            std::fprintf(stderr, "skipping %s: not a binary ppm\n", path.c_str());
+            continue;
+        }
+        frames.push_back(std::move(frame));
+    }
+    if (frames.empty()) {
+        std::fprintf(stderr, "no frames to replay\n");
+        return 1;
+    }
+    
+    Pipeline pipeline(pool, options.get("roi", 1) != 0, ClosedLoop::policyOption(options));
+    if (!pipeline.loadClassifier(options)) return 1;
+    const size_t passes = std::max<size_t>(1, 2000 / frames.size());
+    size_t detections = 0;
+    for (size_t pass = 0; pass < passes; pass++) {
+        for (const Frame& frame : frames) {
+            detections += pipeline.process(frame.pixels.data(), frame.width * 3, frame.width, frame.height);
+        }
+    }
+    
+    std::printf("replayed %zu frames x %zu passes, target found in %zu\n",
+                frames.size(), passes, detections);
+    pipeline.report();
+    return 0;
+}
+
+// open loop over the frames of a recorded session, in timestamp order
+int runSession(const Options& options, WorkerPool& pool) {
+    SessionLogReader reader;
+    if (!reader.open(options.getString("session"))) {
+        std::fprintf(stderr, "cannot open session log %s\n", options.getString("session").c_str());
+        return 1;
+    }
+    
+    Pipeline pipeline(pool, options.get("roi", 1) != 0, ClosedLoop::policyOption(options));
+    if (!pipeline.loadClassifier(options)) return 1;
+    size_t detections = 0, samples = 0, measured = 0;
+    SessionLogReader::Frame frame;
+    TelemetrySample sample;
+    for (size_t i = 0; i < reader.size(); i++) {
+        if (reader.frame(i, frame)) {
+            detections += pipeline.process(frame.data, frame.rowStride, frame.width, frame.height);
+        } else if (reader.sample(i, sample)) {
+            samples++;
+            measured += sample.measured;
+        }
+    }
+    if (pipeline.frames == 0) {
+        std::fprintf(stderr, "no frames in session log\n");
+        return 1;
+    }
+    
+    std::printf("session: %zu frames, target found in %zu; %zu recorded ticks, %zu with a measurement\n",
+                pipeline.frames, detections, samples, measured);
+    pipeline.report();
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv,
+                      {"width", "height", "jumps", "seed", "workers", "roi", "period", "timeout", "latency",
+                       "predict", "lead", "pursuit", "duration", "distractors", "stereo", "incremental", "hold",
+                       "inner_period"},
+                      {"motion", "target", "classifier", "gains", "eyes", "replay", "session"}, options)) {
+        return 1;
+    }
+    WorkerPool pool(static_cast<size_t>(std::max(0.0, options.get("workers", 1))));
+    
+    std::printf("kernel: %s, threads: %zu, classifier: %s\n", segmentKernelName(activeSegmentKernel()),
+                pool.size(), options.getString("classifier").empty() ? "red ratio" : options.getString("classifier").c_str());
+    if (!options.getString("replay").empty()) {
+        return runReplay(options, pool);
+    }
+    if (!options.getString("session").empty()) {
+        return runSession(options, pool);
+    }
+    if (options.get("pursuit", 0.0) > 0.0) {
+        return runPursuit(options, pool);
+    }
+    return runSynthetic(options, pool);
+}
@@ -0,0 +1,153 @@
+// scaling benchmark for the tile-parallel segmentation path, and the cost of
+// reacquiring a lost target through the image pyramid against a full scan.
+// usage: segmentation_bench [max_lanes] [iterations]
+
+#include "ParallelSegmenter.h"
+#include "Segmentation.h"
+#include "TargetDetector.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Frame {
+    size_t width, height, rowStride;
+    std::vector<unsigned char> data;
+};
+
+// grey noise background with a red disc a quarter of the frame height across
+Frame renderFrame(size_t width, size_t height) {
+    Frame frame{width, height, width * 3, std::vector<unsigned char>(width * height * 3)};
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> noise(40, 200);
+    
+    const double cx = width * 0.6, cy = height * 0.4, radius = height / 8.0;
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            unsigned char* p = &frame.data[y * frame.rowStride + 3 * x];
+            const double dx = x - cx, dy = y - cy;
+            if (dx * dx + dy * dy < radius * radius) {
+                p[0] = 220; p[1] = 30; p[2] = 30;
+            } else {
+                p[0] = p[1] = p[2] = static_cast<unsigned char>(noise(rng));
+            }
+        }
+    }
+    return frame;
+}
+
+double medianMicros(std::vector<double>& samples) {
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+    return samples[samples.size() / 2];
+}
+
+template <typename Fn>
+double timeMicros(size_t iterations, Fn&& fn) {
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    for (size_t i = 0; i < iterations; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto stop = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::micro>(stop - start).count());
+    }
+    return medianMicros(samples);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const size_t maxLanes = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+                                     : std::max(1u, std::thread::hardware_concurrency());
+    const size_t iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200;
+    
+    std::printf("kernel: %s, lanes: 1..%zu, iterations: %zu\n",
+                segmentKernelName(activeSegmentKernel()), maxLanes, iterations);
+    
+    // the last entry is a left/right stereo pair laid side by side
+    const size_t sizes[][2] = {{320, 240}, {640, 480}, {1280, 960}, {2560, 960}};
+    
+    for (const auto& size : sizes) {
+        const Frame frame = renderFrame(size[0], size[1]);
+        const Region region{0, 0, frame.width, frame.height};
+        const uint64_t expected = segmentRed(frame.data.data(), frame.rowStride, region).count;
+        
+        std::printf("\n%zux%zu\n%6s %12s %9s\n", frame.width, frame.height,
+                    "lanes", "median us", "speedup");
+        
+        double baseline = 0.0;
+        for (size_t lanes = 1; lanes <= maxLanes; lanes++) {
+            WorkerPool pool(lanes);
+            ParallelSegmenter segmenter(pool);
+            std::vector<double> samples;
+            samples.reserve(iterations);
+            
+            for (size_t i = 0; i < iterations; i++) {
+                const auto start = std::chrono::steady_clock::now();
+                const SegmentMoments moments = segmenter.segment(frame.data.data(), frame.rowStride, region);
+                const auto stop = std::chrono::steady_clock::now();
+                
+                if (moments.count != expected) {
+                    std::fprintf(stderr, "moment mismatch with %zu lanes\n", lanes);
+                    return 1;
+                }
+                samples.push_back(std::chrono::duration<double, std::micro>(stop - start).count());
+            }
+            
+            const double median = medianMicros(samples);
+            if (lanes == 1) baseline = median;
+            std::printf("%6zu %12.1f %8.2fx\n", lanes, median, baseline / median);
+        }
+    }
+    
+    // a lost target: the detectors are reset before every frame, so each
+    // call goes through the subsampled search or the pyramid instead of the
+    // roi window
+    std::printf("\nreacquisition, 1 lane\n%10s %14s %14s %14s %14s %9s\n",
+                "size", "full scan us", "centroid us", "full label us", "pyramid us", "ratio");
+    WorkerPool pool(1);
+    for (const auto& size : sizes) {
+        const Frame frame = renderFrame(size[0], size[1]);
+        const Region region{0, 0, frame.width, frame.height};
+        
+        BlobLabeler labeler(pool);
+        TargetDetector detector(pool);
+        TargetDetector centroidDetector(pool, true, TargetPolicy::Centroid);
+        SegmentMoments moments;
+        const double scan = timeMicros(iterations, [&] {
+            moments = segmentRed(frame.data.data(), frame.rowStride, region);
+        });
+        const double centroid = timeMicros(iterations, [&] {
+            centroidDetector.reset();
+            centroidDetector.detect(frame.data.data(), frame.rowStride, frame.width, frame.height, moments);
+        });
+        if (moments.count != labeler.label(frame.data.data(), frame.rowStride, region,
+                                           TargetDetector::MIN_PIXELS).front().area()) {
+            std::fprintf(stderr, "centroid reacquisition missed the target at %zux%zu\n", size[0], size[1]);
+            return 1;
+        }
+        const double label = timeMicros(iterations, [&] {
+            labeler.label(frame.data.data(), frame.rowStride, region, TargetDetector::MIN_PIXELS);
+        });
+        const double pyramid = timeMicros(iterations, [&] {
+            detector.reset();
+            detector.detect(frame.data.data(), frame.rowStride, frame.width, frame.height, moments);
+        });
+        
+        if (moments.count != labeler.getBlobs().front().area()) {
+            std::fprintf(stderr, "pyramid reacquisition missed the target at %zux%zu\n", size[0], size[1]);
+            return 1;
+        }
+        char name[32];
+        std::snprintf(name, sizeof(name), "%zux%zu", size[0], size[1]);
+        std::printf("%10s %14.1f %14.1f %14.1f %14.1f %8.2fx\n", name, scan, centroid, label, pyramid, label / pyramid);
+    }
+    
+    return 0;
+}
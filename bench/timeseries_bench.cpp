@@ -0,0 +1,128 @@
+// cost of the plot history: appending 50 Hz telemetry rows and decimating
+// the whole history to a plot's pixel width, as the history grows to hours.
+// usage: timeseries_bench [--hours 4] [--pixels 800]
+
+#include "BenchOptions.h"
+#include "TimeSeriesStore.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr double RATE = 50.0;     // rows per second, the control loop
+constexpr size_t COLUMNS = 6;     // what PlotWindow keeps
+constexpr size_t REFRESHES = 50;  // decimations timed per history length
+
+// errors and joint angles with noise, steps and the odd spike
+void sampleRow(double t, std::mt19937& rng, float* row) {
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    const float step = std::fmod(t, 7.0) < 3.5 ? 20.0f : -20.0f;
+    for (size_t c = 0; c < COLUMNS; c++) {
+        row[c] = step * std::sin(0.1f * c * static_cast<float>(t)) + noise(rng);
+    }
+    if (rng() % 5000 == 0) row[0] += 150.0f;
+}
+
+// every bucket of the decimation against a plain scan of the rows
+bool verify(const TimeSeriesStore& store, const std::vector<double>& times,
+            const std::vector<float>& rows, double start, double width, size_t buckets) {
+    std::vector<TimeSeriesStore::Bucket> out(buckets);
+    for (size_t c = 0; c < COLUMNS; c++) {
+        const size_t count = store.decimate(c, start, width, buckets, out.data());
+        size_t b = 0;
+        for (size_t i = 0; i < buckets; i++) {
+            const double t0 = start + i * width, t1 = start + (i + 1) * width;
+            float lo = INFINITY, hi = -INFINITY;
+            const size_t first = std::lower_bound(times.begin(), times.end(), t0) - times.begin();
+            for (size_t r = first; r < times.size() && times[r] < t1; r++) {
+                lo = std::min(lo, rows[r * COLUMNS + c]);
+                hi = std::max(hi, rows[r * COLUMNS + c]);
+            }
+            if (lo > hi) continue;
+            if (b >= count || out[b].time != t0 || out[b].min != lo || out[b].max != hi) return false;
+            b++;
+        }
+        if (b != count) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, {"hours", "pixels"}, {}, options)) {
+        return 1;
+    }
+    const double hours = options.get("hours", 4.0);
+    const double pixelCount = options.get("pixels", 800);
+    if (hours <= 0.0 || pixelCount < 1.0) {
+        std::fprintf(stderr, "hours must be positive and pixels at least 1\n");
+        return 1;
+    }
+    const size_t pixels = static_cast<size_t>(pixelCount);
+    
+    TimeSeriesStore store(COLUMNS, static_cast<size_t>(hours * 3600.0 * RATE));
+    std::printf("capacity %zu rows (%.1f h at %.0f Hz), %.1f MB, decimating to %zu buckets x %zu columns\n",
+                store.capacity(), store.capacity() / RATE / 3600.0, RATE,
+                store.capacity() * (sizeof(double) + COLUMNS * sizeof(float) * (1.0 + 2.0 / 7.0)) / (1 << 20),
+                pixels, COLUMNS);
+    std::printf("%10s %12s %16s %16s\n", "history", "append ns", "full span us", "newest bucket us");
+    
+    std::mt19937 rng(3);
+    std::vector<double> times;  // the same rows in plain arrays, for the check
+    std::vector<float> rows;
+    std::vector<TimeSeriesStore::Bucket> out(pixels + 1);
+    float row[COLUMNS];
+    
+    double t = 0.0;
+    const double checkpoints[] = {60.0, 600.0, 3600.0, 2 * 3600.0, 4 * 3600.0};
+    for (double checkpoint : checkpoints) {
+        if (checkpoint > hours * 3600.0) break;
+        
+        // jittered 50 Hz ticks, like the control loop
+        const auto appendStart = std::chrono::steady_clock::now();
+        size_t appended = 0;
+        while (t < checkpoint) {
+            sampleRow(t, rng, row);
+            store.append(t, row);
+            times.push_back(t);
+            rows.insert(rows.end(), row, row + COLUMNS);
+            t += (1.0 + 0.05 * ((rng() % 200) / 100.0 - 1.0)) / RATE;
+            appended++;
+        }
+        const double appendNs = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - appendStart).count() / appended;
+        
+        // the whole history across the plot, and the one bucket a refresh redoes
+        const double width = (store.lastTime() - store.firstTime()) / pixels;
+        const double start = std::floor(store.firstTime() / width) * width;
+        std::vector<double> full, tail;
+        for (size_t i = 0; i < REFRESHES; i++) {
+            auto begin = std::chrono::steady_clock::now();
+            for (size_t c = 0; c < COLUMNS; c++) store.decimate(c, start, width, pixels + 1, out.data());
+            auto end = std::chrono::steady_clock::now();
+            full.push_back(std::chrono::duration<double, std::micro>(end - begin).count());
+            
+            const double last = std::floor(store.lastTime() / width) * width;
+            begin = std::chrono::steady_clock::now();
+            for (size_t c = 0; c < COLUMNS; c++) store.decimate(c, last, width, 1, out.data());
+            end = std::chrono::steady_clock::now();
+            tail.push_back(std::chrono::duration<double, std::micro>(end - begin).count());
+        }
+        std::nth_element(full.begin(), full.begin() + full.size() / 2, full.end());
+        std::nth_element(tail.begin(), tail.begin() + tail.size() / 2, tail.end());
+        
+        if (!verify(store, times, rows, start, width, pixels + 1)) {
+            std::fprintf(stderr, "decimation differs from a plain scan at %.0f s\n", checkpoint);
+            return 1;
+        }
+        std::printf("%9.0fs %12.1f %16.1f %16.2f\n", checkpoint, appendNs,
+                    full[full.size() / 2], tail[tail.size() / 2]);
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "ColorClassifier.h"
+#include "Segmentation.h"
+#include "WorkerPool.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+// one 8-connected component of red pixels
+struct Blob {
+    uint32_t id = 0;           // kept across frames by BlobSelector
+    SegmentMoments moments;
+    Region box;
+    
+    uint64_t area() const { return moments.count; }
+    double centerX() const { return static_cast<double>(moments.sumX) / moments.count; }
+    double centerY() const { return static_cast<double>(moments.sumY) / moments.count; }
+};
+
+// connected components of the red mask. rows are run-length encoded in
+// parallel row bands, then runs that touch runs of the previous row are
+// merged with union-find in one pass; blob moments are summed per run, so
+// no pixel is visited twice and no label image is written
+class BlobLabeler {
+public:
+    explicit BlobLabeler(WorkerPool& pool, size_t bandsPerLane = 2);
+    
+    // blobs of at least minArea pixels inside region, largest first;
+    // the caller may fill in their ids
+    std::vector<Blob>& label(const unsigned char* data, size_t rowStride,
+                                   const Region& region, uint64_t minArea);
+    const std::vector<Blob>& getBlobs() const { return blobs; }
+    
+    // pixel test, the red test while null; not owned
+    void setClassifier(const ColorClassifier* colorClassifier) { classifier = colorClassifier; }
+    
+private:
+    struct Run {
+        uint32_t x0, x1;  // [x0, x1)
+        uint32_t y;
+        uint32_t parent;
+    };
+    
+    struct alignas(64) Band {
+        std::vector<Run> runs;
+    };
+    
+    void encodeRows(const unsigned char* data, size_t rowStride, const Region& region,
+                    std::vector<Run>& runs) const;
+    uint32_t find(uint32_t i);
+    void unite(uint32_t a, uint32_t b);
+    
+    WorkerPool& pool;
+    const ColorClassifier* classifier;
+    std::vector<Band> bands;
+    std::vector<Run> runs;
+    std::vector<int32_t> blobOfRoot;
+    std::vector<Blob> blobs;
+    
+    static constexpr size_t MIN_BAND_ROWS = 16;
+};
+
+// how the target is chosen among the blobs of a frame
+enum class TargetPolicy {
+    Centroid,  // all red pixels as one target, no labeling
+    Largest,   // blob with the most pixels
+    Nearest,   // blob closest to the last target
+    Tracked    // blob carrying the tracked id, the nearest one when it is lost
+};
+
+const char* targetPolicyName(TargetPolicy policy);
+bool parseTargetPolicy(const std::string& name, TargetPolicy& policy);
+
+// gives blobs ids by matching them to the blobs of the previous frame and
+// picks the target according to the policy
+class BlobSelector {
+public:
+    explicit BlobSelector(TargetPolicy policy = TargetPolicy::Largest);
+    
+    void reset();
+    TargetPolicy getPolicy() const { return policy; }
+    
+    // assigns ids in place; index of the target, -1 if there are no blobs
+    int select(std::vector<Blob>& blobs);
+    
+    // follow the blob with this id from the next frame on (Tracked policy);
+    // safe to call from another thread
+    void track(uint32_t id) { trackedId.store(id, std::memory_order_relaxed); }
+    uint32_t getTrackedId() const { return trackedId.load(std::memory_order_relaxed); }
+    
+    static constexpr double MIN_GATE = 20.0;   // pixels a blob may move between frames
+    static constexpr double GATE_RADII = 2.0;  // plus this many blob radii
+    
+private:
+    struct Previous {
+        uint32_t id;
+        double x, y;
+        double gate;
+    };
+    
+    void assignIds(std::vector<Blob>& blobs);
+    
+    TargetPolicy policy;
+    std::vector<Previous> previous;
+    uint32_t nextId;
+    std::atomic<uint32_t> trackedId;
+    bool hasLast;
+    double lastX, lastY;
+};
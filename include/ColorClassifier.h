@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Segmentation.h"
+#include <string>
+#include <vector>
+
+// one colour rule of a classifier
+struct ColorRule {
+    enum Type { RATIO, HSV, YUV };
+    
+    Type type = RATIO;
+    bool reject = false;      // matching pixels are excluded
+    int channel = 0;          // RATIO: dominant channel, 0 r, 1 g, 2 b
+    double factor = 2.0;      // RATIO: dominant > factor * each other channel
+    double low[3] = {0, 0, 0};   // HSV: h degrees (low > high wraps), s and v in [0, 1]
+    double high[3] = {0, 0, 0};  // YUV: y in [0, 255], u and v in [-128, 127]
+    
+    bool matches(int r, int g, int b) const;
+};
+
+// pixel classifier for the target colour. a pixel is accepted when any
+// accept rule and no reject rule matches. a lone integer ratio rule runs
+// on the simd kernels; any other rule set is evaluated once per colour cell
+// into a bit table of 2^(3*bits) cells, so hsv or yuv rules cost one lookup
+// per pixel
+class ColorClassifier {
+public:
+    // the red test r > 2g && r > 2b
+    ColorClassifier();
+    
+    bool setRules(const std::vector<ColorRule>& rules, int bits = 5);
+    
+    // line format, # starts a comment:
+    //   bits 5|6
+    //   accept|reject ratio r|g|b <factor>
+    //   accept|reject hsv <hmin> <hmax> <smin> <smax> <vmin> <vmax>
+    //   accept|reject yuv <ymin> <ymax> <umin> <umax> <vmin> <vmax>
+    bool load(const std::string& path, std::string& error);
+    
+    bool isFastPath() const { return fastPath; }
+    std::string describe() const;
+    
+    bool test(const unsigned char* pixel) const {
+        if (fastPath) {
+            const int a = ratio.dominant == 0 ? 1 : 0;
+            const int b = ratio.dominant == 2 ? 1 : 2;
+            return pixel[ratio.dominant] > ratio.factor * pixel[a] &&
+                   pixel[ratio.dominant] > ratio.factor * pixel[b];
+        }
+        const uint32_t cell = ((pixel[0] >> shift) << (2 * bits)) |
+                              ((pixel[1] >> shift) << bits) | (pixel[2] >> shift);
+        return (table[cell >> 6] >> (cell & 63)) & 1;
+    }
+    
+    SegmentMoments segment(const unsigned char* data, size_t rowStride, const Region& region) const;
+    SegmentMoments segmentSubsampled(const unsigned char* data, size_t rowStride,
+                                     const Region& region, size_t step) const;
+    
+private:
+    bool fastPath;
+    RatioRule ratio;
+    int bits, shift;
+    std::vector<uint64_t> table;
+    std::vector<ColorRule> rules;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// settling trials for experiments. a trial is armed when the target moves
+// and is decided on the control tick where the gaze, judged on a detection
+// captured after the arm time, has stayed converged for the dwell time, or
+// when the timeout passes. waiters sleep on a condition variable and wake
+// on that tick. once converged, the gaze only counts as leaving through
+// looser thresholds (hysteresis), so noise at the edge does not restart
+// the dwell. times are seconds on the caller's clock
+class ConvergenceMonitor {
+public:
+    struct Options {
+        double dwell = 0.0;       // converged this long before a trial settles
+        double hysteresis = 1.0;  // leave only beyond this times the thresholds
+        double timeout = 10.0;    // a trial gives up after this long
+    };
+    
+    enum class Outcome { Pending, Settled, TimedOut, Cancelled };
+    
+    struct Result {
+        Outcome outcome = Outcome::Pending;
+        double settleTime = 0.0;  // arm to the start of the final converged stretch
+        double elapsed = 0.0;     // arm to the deciding tick
+    };
+    
+    ConvergenceMonitor();
+    
+    // between trials
+    void setOptions(const Options& newOptions);
+    Options getOptions() const;
+    
+    // any thread: starts a trial, replacing one still running; returns its id
+    uint64_t arm(double now);
+    
+    // control thread, every tick. lastCapture is the capture time of the
+    // newest detection; converged is tested against the thresholds and
+    // holding against the thresholds scaled by the hysteresis
+    void update(double now, double lastCapture, bool converged, bool holding);
+    
+    // any thread: waits up to maxWait for the trial; false while it is still
+    // pending. a replaced trial ends as Cancelled
+    bool wait(uint64_t trial, Result& result, double maxWait);
+    
+    // ends the running trial as Cancelled, e.g. on shutdown
+    void cancel();
+
+private:
+    void finish(Outcome outcome, double now);  // under mutex
+    
+    mutable std::mutex mutex;
+    std::condition_variable decided;
+    Options options;
+    uint64_t trial;       // id of the newest trial
+    double armTime;
+    double stretchStart;  // start of the current converged stretch, < 0 outside one
+    Result result;        // of the newest trial
+    std::atomic<bool> pending;  // lets update skip the lock between trials
+};
+
+const char* convergenceOutcomeName(ConvergenceMonitor::Outcome outcome);
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Segmentation.h"
+#include <cstddef>
+#include <vector>
+
+// block-level change detection between consecutive frames. the frame is
+// split into square tiles, and a tile changes when a colour byte in one of
+// its sampled rows differs from the tile's reference by more than the
+// threshold. every step-th row is sampled, starting one row further down on
+// each call, so the comparison reads a step-th of the frame and a change
+// confined to unsampled rows is still seen within step calls; the moving
+// edge of a target crosses sampled rows at once. only changed tiles take
+// the frame as their new reference, so slow drift below the threshold
+// still adds up to a change. tiles can be examined a region at a time; a
+// tile left out keeps its reference and reports the changes since it was
+// last examined
+class FrameChangeDetector {
+public:
+    explicit FrameChangeDetector(size_t tileSize = TILE_SIZE, size_t step = ROW_STEP, int threshold = THRESHOLD);
+    
+    // the next frame counts as changed everywhere
+    void reset();
+    
+    void setThreshold(int byteThreshold) { threshold = byteThreshold; }
+    int getThreshold() const { return threshold; }
+    
+    // compares the tiles overlapping area with their reference and flags the
+    // changed ones, every other tile is unflagged; returns the number
+    // flagged. a first frame or a new size changes every tile
+    size_t update(const unsigned char* data, size_t rowStride, size_t width, size_t height,
+                  const Region& area);
+    
+    size_t tilesX() const { return columns; }
+    size_t tilesY() const { return rows; }
+    size_t tileCount() const { return columns * rows; }
+    bool isChanged(size_t tile) const { return changed[tile] != 0; }
+    Region tileRegion(size_t tile) const;
+    
+    // takes the tile of this frame, of the size last compared, as its
+    // reference, for a caller that works on the tile of a later frame than
+    // the one that flagged it. tiles are disjoint, so several can be taken
+    // at once from different threads
+    void adopt(size_t tile, const unsigned char* data, size_t rowStride);
+    
+    static constexpr size_t TILE_SIZE = 32;
+    static constexpr size_t ROW_STEP = 4;
+    static constexpr int THRESHOLD = 8;  // above the sensor noise, far below a target edge
+
+private:
+    size_t tileSize, step;
+    size_t phase;  // first sampled row of the next call
+    int threshold;
+    size_t width, height;
+    size_t columns, rows;
+    std::vector<unsigned char> reference;  // packed rgb rows
+    std::vector<unsigned char> changed;    // per tile
+};
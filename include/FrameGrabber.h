@@ -0,0 +1,59 @@
+#pragma once
+
+#include <yarp/os/all.h>
+#include <yarp/sig/all.h>
+#include "FramePool.h"
+#include "RealtimeConfig.h"
+#include "SessionRecorder.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+
+using namespace yarp::os;
+using namespace yarp::sig;
+
+// latest-frame mailbox for the camera port. each arriving frame is copied
+// once, on the port's own thread, into a pooled slab; the control loop and
+// the recorder then share that slab by reference. a late frame never stalls
+// the control loop and a consumer always gets the newest one
+class FrameGrabber : public TypedReaderCallback<ImageOf<PixelRgb>> {
+public:
+    FrameGrabber();
+    
+    bool open(const std::string& portName);
+    void close();
+    
+    // newest frame if one arrived since the last call, empty otherwise;
+    // the frame stays valid for as long as the caller holds the handle
+    FrameRef latest();
+    
+    // frames overwritten before the consumer picked them up, or that found
+    // every slab still held
+    unsigned long getDropped() const { return dropped.load(std::memory_order_relaxed); }
+    
+    // scheduling for the port thread that copies the frames, taken on by
+    // that thread with the first frame; set before open()
+    void setSchedule(const ThreadSchedule& portSchedule) { schedule = portSchedule; }
+    
+    // every arriving frame is also handed to the recorder, nullptr stops it
+    void setRecorder(SessionRecorder* sessionRecorder) { recorder.store(sessionRecorder); }
+    
+    using TypedReaderCallback<ImageOf<PixelRgb>>::onRead;
+    void onRead(ImageOf<PixelRgb>& image) override;
+    
+    // one being filled, one waiting, one in the control loop, one per
+    // recorder slot and two waiting for a stereo partner
+    static constexpr size_t POOL_SLABS = 10;
+    
+private:
+    BufferedPort<ImageOf<PixelRgb>> port;
+    FramePool pool;
+    Stamp stamp;     // envelope of the frame being copied, port thread only
+    ThreadSchedule schedule;
+    bool scheduled;  // port thread only
+    FrameRef ready;  // newest complete frame, guarded by mutex
+    bool fresh;
+    std::mutex mutex;
+    std::atomic<unsigned long> dropped;
+    std::atomic<SessionRecorder*> recorder;
+};
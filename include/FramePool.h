@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+class FramePool;
+
+// shared handle to one pooled rgb frame. copies only bump a reference count;
+// the slab goes back to its pool when the last handle lets go. the producer
+// fills the pixels before handing out copies, consumers only read them
+class FrameRef {
+public:
+    FrameRef() noexcept : slab(nullptr) {}
+    FrameRef(const FrameRef& other) noexcept : slab(other.slab) {
+        if (slab) slab->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    FrameRef(FrameRef&& other) noexcept : slab(other.slab) { other.slab = nullptr; }
+    ~FrameRef() { release(); }
+    
+    FrameRef& operator=(FrameRef other) noexcept {
+        std::swap(slab, other.slab);
+        return *this;
+    }
+    
+    explicit operator bool() const { return slab != nullptr; }
+    
+    const unsigned char* data() const { return slab->pixels.get(); }
+    unsigned char* data() { return slab->pixels.get(); }
+    size_t width() const { return slab->width; }
+    size_t height() const { return slab->height; }
+    size_t rowStride() const { return slab->width * 3; }
+    
+    // camera stamp, or the arrival time when the camera does not stamp
+    double timestamp() const { return slab->timestamp; }
+    bool hasStamp() const { return slab->stamped; }
+    void setTimestamp(double time, bool stamped) {
+        slab->timestamp = time;
+        slab->stamped = stamped;
+    }
+    
+private:
+    friend class FramePool;
+    
+    struct Slab {
+        std::atomic<int> refs{0};  // 0 while the slab is free
+        std::unique_ptr<unsigned char[]> pixels;
+        size_t capacity = 0;  // bytes
+        size_t width = 0, height = 0;
+        double timestamp = 0.0;
+        bool stamped = false;
+    };
+    
+    explicit FrameRef(Slab* slab) noexcept : slab(slab) {}
+    
+    void release() {
+        if (slab) slab->refs.fetch_sub(1, std::memory_order_acq_rel);
+        slab = nullptr;
+    }
+    
+    Slab* slab;
+};
+
+// fixed set of preallocated frame buffers. a received frame is copied once
+// into a slab and every consumer shares it through FrameRef handles, so a
+// new consumer adds no copy and no allocation. acquire is lock-free; a slab
+// only reallocates when a frame outgrows it, i.e. on a resolution change.
+// the pool must outlive every handle it gave out
+class FramePool {
+public:
+    // width and height preallocate every slab for that resolution
+    explicit FramePool(size_t slabs, size_t width = 0, size_t height = 0);
+    
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+    
+    // a free slab sized for the frame, empty if every slab is still held
+    FrameRef acquire(size_t width, size_t height);
+    
+    size_t capacity() const { return count; }
+    size_t available() const;
+    
+    // acquire calls that found every slab held
+    unsigned long getExhausted() const { return exhausted.load(std::memory_order_relaxed); }
+    
+private:
+    std::unique_ptr<FrameRef::Slab[]> slabs;
+    size_t count;
+    std::atomic<size_t> next;  // where the next search starts
+    std::atomic<unsigned long> exhausted;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string>
+
+// pid and head gains, set at runtime from a gains file or the command line
+struct GazeGains {
+    double kp = 0.2;            // proportional gain
+    double ki = 0.01;           // integral gain
+    double kd = 0.05;           // derivative gain
+    double headGain = 1.2;      // head movement gain
+    double maxIntegral = 10.0;  // anti-windup limit
+    
+    // line format, # starts a comment, missing gains keep their value:
+    //   kp|ki|kd|head_gain|max_integral <value>
+    bool load(const std::string& path, std::string& error);
+    bool save(const std::string& path, std::string& error) const;
+    
+    // all gains are finite and not negative
+    bool isValid() const;
+    std::string describe() const;
+};
+
+// how the eyes follow the pid
+enum class EyeControlMode {
+    Position,  // a position target on every vision update
+    Velocity   // velocities on every joint tick, holding a head-fixed gaze target
+};
+
+const char* eyeControlModeName(EyeControlMode mode);
+bool parseEyeControlMode(const std::string& name, EyeControlMode& mode);
+
+// pid eye control on the target's pixel error with proportional head
+// compensation. no yarp types, so the same law runs on the robot and
+// against a simulated head.
+// in velocity mode a vision update turns the pid output into a gaze
+// direction relative to the body, and every tick between frames drives the
+// eyes towards it from the encoders alone: a proportional term on the eye
+// position the gaze needs with the neck where it is now, plus the measured
+// neck velocity fed forward so the neck no longer pulls the gaze along
+class GazeController {
+public:
+    // head encoders, degrees
+    struct Encoders {
+        double eyeYaw, eyeTilt;
+        double neckPitch, neckYaw;
+        double neckPitchVelocity, neckYawVelocity;  // degrees/s, read in velocity mode only
+    };
+    
+    struct Command {
+        bool moveEyes;                             // new eye targets this tick
+        double eyeYaw, eyeTilt;                    // position targets, degrees
+        bool moveEyeVelocity;                      // velocity mode, instead of moveEyes
+        double eyeYawVelocity, eyeTiltVelocity;    // degrees/s
+        double neckPitchVelocity, neckYawVelocity; // degrees/s
+        bool moveVergence;                         // new vergence target this tick
+        double eyeVergence;                        // position target, degrees
+    };
+    
+    GazeController();
+    
+    void reset();
+    
+    // takes effect from the next update
+    void setGains(const GazeGains& gains) { this->gains = gains; }
+    const GazeGains& getGains() const { return gains; }
+    
+    // resets the controller
+    void setMode(EyeControlMode eyeMode);
+    EyeControlMode getMode() const { return mode; }
+    
+    // vision update: pid on the target's offset from the image centre
+    void updateError(int errorX, int errorY);
+    
+    // stereo update: vergence that puts both eyes on the target, degrees.
+    // the command follows it through a first-order filter
+    void updateVergence(double vergence);
+    
+    // joint update, every tick; measured is true when updateError ran this tick.
+    // in velocity mode this is the inner loop and may run faster than vision
+    Command step(const Encoders& encoders, bool measured);
+    
+    // errors and eyes within the settling thresholds, times scale
+    bool isConverged(const Encoders& encoders, double scale = 1.0) const;
+    
+    int getErrorX() const { return errX; }
+    int getErrorY() const { return errY; }
+    double getEyeYawTarget() const { return eyeYawPosition; }
+    double getEyeTiltTarget() const { return eyeTiltPosition; }
+    double getVergenceTarget() const { return vergencePosition; }
+    
+    // control parameters
+    static constexpr double CENTERED = 0.1;  // degrees, eyes count as centred below this
+    static constexpr double VERGENCE_GAIN = 0.5;  // share of the vergence error taken per update
+    static constexpr double MAX_VERGENCE = 50.0;  // degrees, joint range is [0, MAX_VERGENCE]
+    static constexpr double EYE_LOOP_GAIN = 50.0;  // 1/s, velocity mode eye position loop
+    static constexpr double MAX_EYE_VELOCITY = 100.0;  // degrees/s
+    
+    // movement thresholds
+    static constexpr double POSITION_THRESHOLD = 0.2;  // degrees
+    static constexpr double ERROR_THRESHOLD = 1.0;     // pixels
+    
+private:
+    Command stepVelocity(const Encoders& encoders, bool measured);
+    
+    GazeGains gains;
+    EyeControlMode mode;
+    double eyeTiltPosition, eyeYawPosition;
+    double gazeYawTarget, gazeTiltTarget;  // velocity mode, eye plus neck angles
+    int errX, errY;
+    int lastErrX, lastErrY;
+    double integralX, integralY;  // integral terms for pid
+    double degX, degY;            // pid output of the last vision update
+    double vergencePosition;
+    bool vergencePending;         // updateVergence ran since the last step
+};
@@ -3,65 +3,150 @@
 #include <yarp/os/all.h>
 #include <yarp/sig/all.h>
 #include <yarp/dev/all.h>
+#include "ConvergenceMonitor.h"
+#include "FrameGrabber.h"
+#include "GazeController.h"
+#include "LoopStatistics.h"
+#include "RealtimeConfig.h"
+#include "SessionRecorder.h"
+#include "StartupProfile.h"
+#include "StereoVision.h"
+#include "TargetDetector.h"
+#include "TargetPredictor.h"
+#include "Telemetry.h"
+#include "TelemetryPort.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 using namespace yarp::os;
 using namespace yarp::sig;
 using namespace yarp::dev;
 
-class GazeThread : public PeriodicThread {
+class GazeThread : public PeriodicThread, public PortReader {
 public:
-    bool isMovementDone;
-    
-    GazeThread(double period);
+    // sharedWorkers, when given, segments for this controller instead of a
+    // pool of its own and must outlive it
+    GazeThread(double period, WorkerPool* sharedWorkers = nullptr);
     ~GazeThread();
     
-    bool configure();
+    bool configure(Searchable& config);
+    const std::string& getName() const { return name; }
+    
+    // --sched, --priority, --cpus and their capture_ counterparts
+    static bool readSchedules(Searchable& config, ThreadSchedule& control, ThreadSchedule& capture,
+                              std::string& error);
+    
+    // per-tick records for plotting and logging; readers drain it with
+    // their own cursor and never block the control thread
+    const TelemetryChannel& getTelemetry() const { return telemetry; }
+    
+    // settling trials: arm one when the target moves and wait on it; it is
+    // decided on the control tick the gaze settles on a fresh detection
+    ConvergenceMonitor& getConvergence() { return convergence; }
+    
+    // per-stage latency histograms, also served on <name>/rpc
+    const LoopStatistics& getStatistics() const { return stats; }
     
-    // getters for plotting
-    double getErrorX() const { return errX; }
-    double getErrorY() const { return errY; }
-    double getEyeX() const { return eyeYawPosition; }
-    double getEyeY() const { return eyeTiltPosition; }
-    double getNeckPitch() const { return neckPitchPosition; }
-    double getNeckYaw() const { return neckYawPosition; }
+    // rpc commands
+    bool read(ConnectionReader& connection) override;
     
 protected:
+    bool threadInit() override;
     void run() override;
     void threadRelease() override;
     
 private:
-    // yarp interfaces
-    Network yarp;
+    // one control cycle; the caller publishes its telemetry afterwards
+    void controlTick();
+    void publishTelemetry();
+    
+    // detect the target in a new frame, or in both frames of a stereo pair;
+    // without prediction the pid runs on its error right away
+    bool updateVision(const FrameRef& frame, const FrameRef& rightFrame);
+    
+    // vergence from the last stereo detection and the current eye pose
+    void updateVergence();
+    
+    // neck, and velocity eyes, at rest
+    void stopHead();
+    
+    // yarp interfaces; the process holds the network
+    std::string name, robot;  // port prefixes
     Property prop;
     PolyDriver robotHead;
     IPositionControl* ipc;
     IVelocityControl* ivc;
     IControlMode* icm;
     IEncoders* enc;
-    BufferedPort<ImageOf<PixelRgb>> imagePort;
+    std::vector<double> encoders;  // all head joints, read in one call
+    std::vector<double> speeds;    // joint velocities, only read with velocity eyes
+    FrameGrabber grabber;       // left camera, the only one in mono
+    FrameGrabber rightGrabber;  // only opened with --stereo
+    RpcServer rpcPort;
+    ThreadSchedule controlSchedule;  // also the segmentation workers'
     
     // control state
-    double eyeTiltPosition, eyeYawPosition;
-    double eyeEncoderTiltPosition, eyeEncoderYawPosition;
-    double neckPitchPosition, neckYawPosition;
-    int errX, errY;
-    int lastErrX, lastErrY;
-    double integralX, integralY;  // integral terms for pid
-    
-    // control parameters
-    static constexpr double Kp = 0.2;   // proportional gain
-    static constexpr double Ki = 0.01;  // integral gain
-    static constexpr double Kd = 0.05;  // derivative gain
-    static constexpr double HEAD_GAIN = 1.2;  // head movement gain
-    static constexpr double MAX_INTEGRAL = 10.0;  // anti-windup limit
-    
-    // image dimensions
-    static constexpr double IMAGE_WIDTH = 320.0;
-    static constexpr double IMAGE_HEIGHT = 240.0;
-    static constexpr double CENTER_X = IMAGE_WIDTH / 2.0;
-    static constexpr double CENTER_Y = IMAGE_HEIGHT / 2.0;
-    
-    // movement thresholds
-    static constexpr double POSITION_THRESHOLD = 0.2;  // degrees
-    static constexpr double ERROR_THRESHOLD = 1.0;     // pixels
+    GazeController controller;
+    GazeController::Encoders head;
+    bool hasTarget;
+    
+    // settling, judged after every tick
+    ConvergenceMonitor convergence;
+    double settleHysteresis;
+    double lastCapture;  // capture time of the newest detection
+    bool converged, holding;  // this tick, against the plain and the hysteresis thresholds
+    
+    // latency compensation: detections feed the predictor at their capture
+    // time and the pid runs every tick on the error expected lead seconds ahead
+    std::unique_ptr<TargetPredictor> predictor;  // only with --predict 1
+    double lead;
+    double targetErrorX, targetErrorY;  // pixel error of the last detection
+    size_t imageWidth;
+    
+    // startup, for the time to the first detection
+    double startTime;
+    bool trackingReported;
+    
+    // telemetry
+    TelemetryChannel telemetry;
+    TelemetrySample sample;  // record of the running tick
+    StageTimer stageTimer;
+    uint64_t tick;
+    LoopStatistics stats;
+    std::unique_ptr<SessionRecorder> recorder;  // only with --record
+    std::unique_ptr<TelemetryPublisher> publisher;  // unless --telemetry 0
+    
+    // detection
+    WorkerPool* pool;  // workers, or a host's shared pool
+    std::unique_ptr<WorkerPool> workers;
+    std::unique_ptr<TargetDetector> detector;
+    std::vector<Blob> blobs;  // copy of the last detection for the rpc thread
+    int selectedBlob;
+    std::mutex blobMutex;
+    
+    // stereo: frames paired by timestamp, both eyes detected at once and the
+    // target triangulated for vergence; all unset in mono
+    std::unique_ptr<WorkerPool> rightWorkers;
+    std::unique_ptr<TargetDetector> rightDetector;
+    std::unique_ptr<StereoDetector> stereo;
+    StereoPairer pairer;
+    StereoGeometry geometry;
+    StereoDetection stereoDetection;  // of the frame pair in this tick
+    StereoTarget stereoTarget;        // last triangulation, for rpc under blobMutex
+    bool hasStereoTarget;
+    
+    static constexpr double STARTUP_POLL = 0.01;  // seconds between readiness checks
+    
+    // head joint indices
+    static constexpr int NECK_PITCH = 0;
+    static constexpr int NECK_YAW = 2;
+    static constexpr int EYE_TILT = 3;
+    static constexpr int EYE_YAW = 4;  // version
+    static constexpr int EYE_VERGENCE = 5;
+    
+    // joint groups for multi-joint commands, in command order
+    static constexpr int NECK_JOINTS[2] = {NECK_PITCH, NECK_YAW};
+    static constexpr int EYE_JOINTS[2] = {EYE_YAW, EYE_TILT};
 };
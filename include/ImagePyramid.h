@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// 2x box-filtered pyramid of an interleaved rgb frame. level 0 is the
+// caller's buffer and is never copied; the coarser levels live in buffers
+// that are kept between frames and only grow when the frame does
+class ImagePyramid {
+public:
+    struct Level {
+        const unsigned char* data;
+        size_t width, height, rowStride;
+        size_t scale;  // full-resolution pixels per level pixel, per axis
+    };
+    
+    // halves the frame until the next level would be narrower than minWidth,
+    // at most maxLevels - 1 times
+    void build(const unsigned char* data, size_t rowStride, size_t width, size_t height,
+               size_t maxLevels = MAX_LEVELS, size_t minWidth = MIN_WIDTH);
+    
+    size_t levels() const { return count; }
+    const Level& level(size_t i) const { return pyramid[i]; }
+    const Level& coarsest() const { return pyramid[count - 1]; }
+    
+    static constexpr size_t MAX_LEVELS = 4;
+    static constexpr size_t MIN_WIDTH = 64;
+    
+private:
+    // one 2x2 box average of src into dst, which holds (width/2) x (height/2)
+    static void downsample(const unsigned char* src, size_t srcStride, size_t width, size_t height,
+                           unsigned char* dst, size_t dstStride);
+    
+    Level pyramid[MAX_LEVELS] = {};
+    std::vector<unsigned char> buffers[MAX_LEVELS];
+    size_t count = 0;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "LatencyHistogram.h"
+#include "Telemetry.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// latency histograms for every stage of the control tick, the whole tick,
+// the camera-to-actuation path and the start jitter, plus a count of ticks
+// that overran the period
+class LoopStatistics {
+public:
+    struct Summary {
+        std::string name;
+        uint64_t count;
+        double p50, p99, p999, max;  // seconds
+    };
+    
+    explicit LoopStatistics(double period);
+    
+    // for a loop whose period changes before it starts; clears the histograms
+    void setPeriod(double seconds);
+    
+    // called from the control thread at the start of every tick: how far
+    // the time since the previous start is off the period
+    void recordStart();
+    // and once per tick when it is done
+    void record(const TelemetrySample& sample);
+    void reset();
+    
+    std::vector<Summary> summaries() const;
+    uint64_t getOverruns() const { return overruns.load(std::memory_order_relaxed); }
+    uint64_t getTicks() const { return tick.count(); }
+    
+    // multi-line table in milliseconds
+    std::string report() const;
+    
+private:
+    double period;
+    LatencyHistogram stages[STAGE_COUNT];
+    LatencyHistogram tick;
+    LatencyHistogram camera;
+    LatencyHistogram jitter;
+    std::atomic<uint64_t> overruns;
+    std::chrono::steady_clock::time_point lastStart;  // control thread only
+    bool started;
+};
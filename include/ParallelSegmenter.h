@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ColorClassifier.h"
+#include "Segmentation.h"
+#include "WorkerPool.h"
+#include <vector>
+
+// splits a region into row bands and segments them on a worker pool. each
+// band writes its moments to its own cache line and the caller sums them
+// after the join, so the merge needs no locks or atomics
+class ParallelSegmenter {
+public:
+    // bandsPerLane > 1 lets faster lanes pick up the slack of slower ones
+    explicit ParallelSegmenter(WorkerPool& pool, size_t bandsPerLane = 2);
+    
+    SegmentMoments segment(const unsigned char* data, size_t rowStride, const Region& region);
+    
+    size_t lanes() const { return pool.size(); }
+    
+    // pixel test of every band, the red test while null; not owned
+    void setClassifier(const ColorClassifier* colorClassifier) { classifier = colorClassifier; }
+    
+private:
+    struct alignas(64) Partial {
+        SegmentMoments moments;
+    };
+    
+    SegmentMoments scan(const unsigned char* data, size_t rowStride, const Region& region) const {
+        return classifier ? classifier->segment(data, rowStride, region) : segmentRed(data, rowStride, region);
+    }
+    
+    WorkerPool& pool;
+    const ColorClassifier* classifier;
+    std::vector<Partial> partials;
+    
+    static constexpr size_t MIN_BAND_ROWS = 16;  // below this a band is not worth a hand-off
+};
@@ -2,8 +2,11 @@
 
 #include <QMainWindow>
 #include <QTimer>
-#include <deque>
+#include <cstdint>
+#include <vector>
 #include "qcustomplot.h"
+#include "Telemetry.h"
+#include "TimeSeriesStore.h"
 
 class PlotWindow : public QMainWindow {
     Q_OBJECT
@@ -13,6 +16,9 @@ public:
     void addDataPoint(double errorX, double errorY, 
                      double eyeX, double eyeY,
                      double neckPitch, double neckYaw);
+    
+    // drain control-loop records on every refresh instead of sampling getters
+    void setTelemetrySource(const TelemetryChannel* channel);
 
 private slots:
     void updatePlot();
@@ -22,19 +28,29 @@ private:
     QCustomPlot *positionPlot;  // Combined eye and neck positions
     QTimer dataTimer;
     
-    static const int MAX_POINTS = 200;  // Maximum points to show
+    // columns of the history, one per graph
+    enum Column { ERROR_X, ERROR_Y, EYE_YAW, EYE_TILT, NECK_YAW, NECK_PITCH, COLUMN_COUNT };
+    static const size_t HISTORY_ROWS = 720000;  // 4 h at 50 Hz, 1 h with velocity eyes, then the oldest rows go
     
-    // Data storage
-    std::deque<double> timePoints;
-    std::deque<double> errorXData;
-    std::deque<double> errorYData;
-    std::deque<double> eyeXData;
-    std::deque<double> eyeYData;
-    std::deque<double> neckPitchData;
-    std::deque<double> neckYawData;
+    // Data storage: every point, decimated to min/max buckets about a
+    // pixel wide when plotted
+    TimeSeriesStore history;
+    double bucketWidth;  // seconds, a power of two; 0 until the first refresh
+    int64_t openBucket;  // newest plotted bucket, still taking rows
+    std::vector<TimeSeriesStore::Bucket> buckets;
+    QVector<QCPGraphData> points;
     
     double startTime;
     
+    // Telemetry input
+    const TelemetryChannel* telemetry;
+    TelemetryChannel::Cursor telemetryCursor;
+    double telemetryOrigin;
+    
+    void appendPoint(double time, double errorX, double errorY,
+                     double eyeX, double eyeY,
+                     double neckPitch, double neckYaw);
     void setupErrorPlot();
     void setupPositionPlot();  // Combined setup for eye and neck
+    QCPGraph* graphFor(size_t column) const;
 };
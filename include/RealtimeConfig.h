@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// posix scheduling for the latency-critical threads: a real-time policy and
+// priority, the cpus a thread may run on, and memory that is locked and
+// faulted in before the first tick so no page fault lands in one
+enum class SchedulePolicy {
+    Other,      // the default time-shared scheduler, priority ignored
+    Fifo,       // SCHED_FIFO, runs until it blocks or a higher priority wakes
+    RoundRobin  // SCHED_RR, FIFO with a time slice among equal priorities
+};
+
+const char* schedulePolicyName(SchedulePolicy policy);
+bool parseSchedulePolicy(const std::string& name, SchedulePolicy& policy);
+
+struct ThreadSchedule {
+    SchedulePolicy policy = SchedulePolicy::Other;
+    int priority = 0;       // 1 to 99 for the real-time policies
+    std::vector<int> cpus;  // allowed cpus, empty for any
+    
+    bool isDefault() const { return policy == SchedulePolicy::Other && cpus.empty(); }
+    std::string describe() const;
+};
+
+// "2", "2,3" or "0-3,6"; false with a message on anything else
+bool parseCpuList(const std::string& text, std::vector<int>& cpus, std::string& error);
+
+// applies to the calling thread; false with a message, typically for a
+// missing CAP_SYS_NICE or rtprio limit, and the thread keeps its old policy
+bool applyThreadSchedule(const ThreadSchedule& schedule, std::string& error);
+
+// locks every current and future page of the process in ram, which also
+// faults in buffers allocated so far, and stops malloc from handing memory
+// back to the system so a freed and reused block never faults again
+bool lockProcessMemory(std::string& error);
+
+constexpr size_t PREFAULT_STACK_BYTES = 256 << 10;
+
+// touches bytes of the calling thread's stack, so its deepest calls later
+// find the pages already mapped
+void prefaultStack(size_t bytes = PREFAULT_STACK_BYTES);
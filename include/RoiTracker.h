@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Segmentation.h"
+
+// adaptive search window around the last target centroid. the window covers
+// the blob itself plus the motion expected before the next frame, which
+// grows with the centroid velocity and with the gaze error being corrected
+class RoiTracker {
+public:
+    RoiTracker();
+
+    void reset();
+    bool isLocked() const { return locked; }
+
+    // window to scan in the next frame; the whole frame while not locked
+    Region searchWindow(size_t width, size_t height) const;
+
+    // feed the result of the last search; lose() drops back to full frames
+    void update(const SegmentMoments& moments, double errorX, double errorY);
+    void lose() { reset(); }
+
+    // window around a blob found by a coarse search, where each sample
+    // stands for sampleArea full-resolution pixels
+    static Region blobWindow(const SegmentMoments& moments, double sampleArea,
+                             size_t width, size_t height);
+
+private:
+    bool locked;
+    double centerX, centerY;
+    double velocityX, velocityY;
+    double halfWidth, halfHeight;
+
+    static constexpr double MIN_HALF_SIZE = 16.0;     // pixels
+    static constexpr double BLOB_MARGIN = 1.5;        // blob radii kept around the centroid
+    static constexpr double VELOCITY_GAIN = 2.0;      // frames of motion covered
+    static constexpr double ERROR_GAIN = 0.5;         // share of the gaze error covered
+    static constexpr double VELOCITY_SMOOTHING = 0.5; // low-pass on centroid velocity
+
+    static Region clampWindow(double x, double y, double halfWidth, double halfHeight,
+                              size_t width, size_t height);
+};
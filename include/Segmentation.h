@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// first-order image moments of the pixels accepted by a segmentation pass
+struct SegmentMoments {
+    uint64_t count = 0;
+    uint64_t sumX = 0;
+    uint64_t sumY = 0;
+
+    SegmentMoments& operator+=(const SegmentMoments& other) {
+        count += other.count;
+        sumX += other.sumX;
+        sumY += other.sumY;
+        return *this;
+    }
+    
+    // other must be part of these moments
+    SegmentMoments& operator-=(const SegmentMoments& other) {
+        count -= other.count;
+        sumX -= other.sumX;
+        sumY -= other.sumY;
+        return *this;
+    }
+};
+
+// pixel window [x0, x1) x [y0, y1)
+struct Region {
+    size_t x0 = 0, y0 = 0;
+    size_t x1 = 0, y1 = 0;
+
+    size_t width() const { return x1 > x0 ? x1 - x0 : 0; }
+    size_t height() const { return y1 > y0 ? y1 - y0 : 0; }
+    bool empty() const { return width() == 0 || height() == 0; }
+};
+
+enum class SegmentKernel { Scalar, SSE2, AVX2 };
+
+// best kernel supported by the cpu, resolved once at startup
+SegmentKernel activeSegmentKernel();
+const char* segmentKernelName(SegmentKernel kernel);
+bool segmentKernelSupported(SegmentKernel kernel);
+
+// one channel exceeds factor times each of the other two; the kernels are
+// compiled for every channel and for factors 1 to 3
+struct RatioRule {
+    int dominant = 0;  // 0 r, 1 g, 2 b
+    int factor = 2;
+    
+    bool valid() const;
+};
+
+// red pixel test (r > 2g && r > 2b) over an interleaved rgb buffer,
+// streamed row by row; rowStride is the distance between rows in bytes
+SegmentMoments segmentRed(const unsigned char* data, size_t rowStride, const Region& region);
+SegmentMoments segmentRed(const unsigned char* data, size_t rowStride, const Region& region,
+                          SegmentKernel kernel);
+
+// the same scan for any ratio rule
+SegmentMoments segmentRatio(const unsigned char* data, size_t rowStride, const Region& region,
+                            const RatioRule& rule);
+SegmentMoments segmentRatio(const unsigned char* data, size_t rowStride, const Region& region,
+                            const RatioRule& rule, SegmentKernel kernel);
+
+// coarse search that tests every step-th pixel of every step-th row;
+// sums are reported in full-resolution coordinates
+SegmentMoments segmentRedSubsampled(const unsigned char* data, size_t rowStride,
+                                    const Region& region, size_t step);
+SegmentMoments segmentRatioSubsampled(const unsigned char* data, size_t rowStride,
+                                      const Region& region, const RatioRule& rule, size_t step);
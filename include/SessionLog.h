@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Telemetry.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// append-only binary session log. the file is a header followed by 8-byte
+// aligned records {type, size, timestamp, payload}; it grows in fixed chunks
+// that are memory-mapped one at a time, and a record never straddles two
+// chunks. close() appends a timestamp index and links it from the header;
+// a log that was not closed cleanly is re-indexed by scanning on open
+namespace sessionlog {
+
+enum RecordType : uint32_t {
+    RECORD_PAD = 0,     // filler up to the end of a chunk
+    RECORD_FRAME = 1,   // FrameHeader + packed rgb rows
+    RECORD_SAMPLE = 2,  // TelemetrySample
+    RECORD_INDEX = 3    // IndexEntry array
+};
+
+struct FileHeader {
+    char magic[8];          // "GAZELOG1"
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t chunkSize;
+    uint64_t indexOffset;   // 0 until the log is closed
+    uint64_t recordCount;
+    uint64_t reserved[3];
+};
+
+struct RecordHeader {
+    uint32_t type;
+    uint32_t size;          // payload bytes, without padding
+    double timestamp;       // seconds
+};
+
+struct FrameHeader {
+    uint32_t width;
+    uint32_t height;
+};
+
+struct IndexEntry {
+    double timestamp;
+    uint64_t offset;        // of the RecordHeader
+    uint32_t type;
+    uint32_t reserved;
+};
+
+} // namespace sessionlog
+
+class SessionLogWriter {
+public:
+    SessionLogWriter();
+    ~SessionLogWriter();
+    
+    SessionLogWriter(const SessionLogWriter&) = delete;
+    SessionLogWriter& operator=(const SessionLogWriter&) = delete;
+    
+    bool open(const std::string& path, size_t chunkSize = 64 << 20);
+    // writes the index and trims the file; false if the log may need a rescan
+    bool close();
+    bool isOpen() const { return fd >= 0; }
+    
+    // rows are packed on write, rowStride may include padding
+    bool appendFrame(double timestamp, const unsigned char* data,
+                     size_t width, size_t height, size_t rowStride);
+    bool appendSample(const TelemetrySample& sample);
+    
+    uint64_t bytesWritten() const { return offset; }
+    
+private:
+    // space for a record of the given size, mapping the next chunk if needed
+    unsigned char* reserve(uint32_t type, uint32_t size, double timestamp);
+    bool mapChunk(uint64_t chunk);
+    void unmapChunk();
+    
+    int fd;
+    size_t chunkSize;
+    uint64_t offset;        // end of the last record
+    uint64_t mappedChunk;
+    unsigned char* mapped;
+    std::vector<sessionlog::IndexEntry> index;
+};
+
+class SessionLogReader {
+public:
+    struct Record {
+        uint32_t type;
+        double timestamp;
+        const unsigned char* payload;
+        uint32_t size;
+    };
+    
+    // view of a frame record, pointing into the mapping
+    struct Frame {
+        double timestamp;
+        size_t width, height, rowStride;
+        const unsigned char* data;
+    };
+    
+    SessionLogReader();
+    ~SessionLogReader();
+    
+    SessionLogReader(const SessionLogReader&) = delete;
+    SessionLogReader& operator=(const SessionLogReader&) = delete;
+    
+    bool open(const std::string& path);
+    void close();
+    
+    size_t size() const { return index.size(); }
+    const std::vector<sessionlog::IndexEntry>& getIndex() const { return index; }
+    
+    // first record at or after the timestamp
+    size_t seek(double timestamp) const;
+    // next record of the given type at or after position i, size() if none
+    size_t next(size_t i, uint32_t type) const;
+    
+    Record record(size_t i) const;
+    bool frame(size_t i, Frame& frame) const;
+    bool sample(size_t i, TelemetrySample& sample) const;
+    
+private:
+    bool validIndex(uint64_t headerSize) const;
+    bool scan();
+    
+    int fd;
+    const unsigned char* mapped;
+    size_t length;
+    std::vector<sessionlog::IndexEntry> index;
+};
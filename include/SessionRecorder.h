@@ -0,0 +1,70 @@
+#pragma once
+
+#include "FramePool.h"
+#include "SessionLog.h"
+#include "Telemetry.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// background writer for the session log. camera frames are handed over by
+// reference through a few slots, without a copy, and telemetry is drained
+// from the control loop's ring, so neither the capture thread nor the
+// control thread ever waits on the disk; frames that find no free slot are
+// dropped
+class SessionRecorder {
+public:
+    explicit SessionRecorder(const TelemetryChannel& telemetry);
+    ~SessionRecorder();
+    
+    SessionRecorder(const SessionRecorder&) = delete;
+    SessionRecorder& operator=(const SessionRecorder&) = delete;
+    
+    bool open(const std::string& path, size_t frameSlots = 4);
+    void close();
+    bool isOpen() const { return running.load(std::memory_order_acquire); }
+    
+    // single producer, never blocks; false if the frame was dropped. the
+    // frame's slab stays held until it is on disk
+    bool pushFrame(const FrameRef& frame);
+    
+    unsigned long getDroppedFrames() const { return droppedFrames.load(std::memory_order_relaxed); }
+    uint64_t getLostSamples() const { return lostSamples.load(std::memory_order_relaxed); }
+    uint64_t bytesWritten() const { return written.load(std::memory_order_relaxed); }
+    
+    static constexpr double WRITE_INTERVAL = 0.01;  // seconds between telemetry drains
+    
+private:
+    enum SlotState { SLOT_FREE, SLOT_READY };
+    
+    struct FrameSlot {
+        std::atomic<int> state{SLOT_FREE};
+        uint64_t sequence = 0;
+        FrameRef frame;
+    };
+    
+    void writerLoop();
+    // writes ready frames in arrival order, returns how many were written
+    size_t writeFrames();
+    
+    const TelemetryChannel& telemetry;
+    TelemetryChannel::Cursor cursor;
+    SessionLogWriter writer;
+    
+    std::unique_ptr<FrameSlot[]> slots;
+    size_t slotCount;
+    uint64_t nextSequence;
+    
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::atomic<bool> running;
+    bool stopping;
+    
+    std::atomic<unsigned long> droppedFrames;
+    std::atomic<uint64_t> lostSamples;
+    std::atomic<uint64_t> written;
+};
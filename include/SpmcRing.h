@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// single-producer / multi-consumer broadcast ring. the producer never waits:
+// it overwrites the oldest slot, and every consumer keeps its own cursor and
+// detects overrun through a per-slot sequence number (seqlock). payloads are
+// moved through relaxed atomic words so readers racing a writer stay defined
+template <typename T, size_t Capacity>
+class SpmcRing {
+    static_assert(std::is_trivially_copyable<T>::value, "ring payload must be trivially copyable");
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+    
+public:
+    // per-consumer read position
+    struct Cursor {
+        uint64_t next = 0;
+        uint64_t lost = 0;  // records overwritten before this consumer read them
+    };
+    
+    SpmcRing() : head(0) {
+        for (Slot& slot : slots) slot.sequence.store(0, std::memory_order_relaxed);
+    }
+    
+    // producer side, wait-free
+    void publish(const T& value) {
+        const uint64_t n = head.load(std::memory_order_relaxed);
+        Slot& slot = slots[n & (Capacity - 1)];
+        
+        uint64_t words[WORDS] = {};
+        std::memcpy(words, &value, sizeof(T));
+        
+        // odd sequence marks the slot as being written
+        slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; i++) {
+            slot.words[i].store(words[i], std::memory_order_relaxed);
+        }
+        slot.sequence.store(2 * n + 2, std::memory_order_release);
+        head.store(n + 1, std::memory_order_release);
+    }
+    
+    // cursor positioned at the next record to be published
+    Cursor tail() const {
+        Cursor cursor;
+        cursor.next = head.load(std::memory_order_acquire);
+        return cursor;
+    }
+    
+    uint64_t published() const { return head.load(std::memory_order_acquire); }
+    
+    // hands every record published since the cursor to fn, oldest first.
+    // never blocks the producer; records it laps are counted in cursor.lost
+    template <typename Fn>
+    size_t drain(Cursor& cursor, Fn&& fn) const {
+        const uint64_t end = head.load(std::memory_order_acquire);
+        if (end - cursor.next > Capacity) {
+            cursor.lost += end - cursor.next - Capacity;
+            cursor.next = end - Capacity;
+        }
+        
+        size_t count = 0;
+        T value;
+        for (; cursor.next < end; cursor.next++) {
+            if (!read(cursor.next, value)) {
+                cursor.lost++;
+                continue;
+            }
+            fn(value);
+            count++;
+        }
+        return count;
+    }
+    
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> sequence;
+        std::atomic<uint64_t> words[WORDS];
+    };
+    
+    bool read(uint64_t n, T& value) const {
+        const Slot& slot = slots[n & (Capacity - 1)];
+        const uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before != 2 * n + 2) return false;  // overwritten or still being written
+        
+        uint64_t words[WORDS];
+        for (size_t i = 0; i < WORDS; i++) {
+            words[i] = slot.words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != before) return false;
+        
+        std::memcpy(&value, words, sizeof(T));
+        return true;
+    }
+    
+    alignas(64) std::atomic<uint64_t> head;
+    Slot slots[Capacity];
+};
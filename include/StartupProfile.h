@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+// time spent in each startup phase, for the startup log line; a phase ends
+// where the next one is marked
+class StartupProfile {
+public:
+    StartupProfile();
+    
+    // ends the running phase under this name and starts the next one
+    void mark(const std::string& phase);
+    
+    // a phase timed elsewhere, e.g. on another thread
+    void add(const std::string& phase, double seconds);
+    
+    // seconds since construction
+    double elapsed() const;
+    
+    // "ports 12 ms, head 85 ms, ..., total 410 ms"
+    std::string describe() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    
+    struct Phase {
+        std::string name;
+        double seconds;
+    };
+    
+    Clock::time_point start, last;
+    std::vector<Phase> phases;
+};
+
+// polls ready every poll seconds until it returns true or timeout seconds
+// have passed; returns the last answer. ready is asked at least once
+bool waitUntil(const std::function<bool()>& ready, double timeout, double poll = 0.01);
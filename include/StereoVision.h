@@ -0,0 +1,113 @@
+#pragma once
+
+#include "FramePool.h"
+#include "TargetDetector.h"
+#include "WorkerPool.h"
+#include <cstddef>
+#include <functional>
+
+// pairs left and right camera frames by timestamp. each side keeps its
+// newest few frames; a pair is the newest left/right match within maxSkew
+// that is newer than the last pair, and everything older is dropped
+class StereoPairer {
+public:
+    explicit StereoPairer(double maxSkew = MAX_SKEW);
+    
+    void reset();
+    void pushLeft(FrameRef frame) { push(left, std::move(frame)); }
+    void pushRight(FrameRef frame) { push(right, std::move(frame)); }
+    
+    // false, and both handles empty, while no new pair is complete
+    bool pair(FrameRef& leftFrame, FrameRef& rightFrame);
+    
+    // frames dropped without a partner
+    unsigned long getUnpaired() const { return unpaired; }
+    
+    static constexpr double MAX_SKEW = 0.015;  // seconds, half a 30 Hz frame
+    static constexpr size_t DEPTH = 2;         // frames kept per side
+    
+private:
+    struct Side {
+        FrameRef frames[DEPTH];  // oldest first
+        size_t count = 0;
+    };
+    
+    void push(Side& side, FrameRef frame);
+    void dropThrough(Side& side, size_t index);
+    
+    double maxSkew;
+    Side left, right;
+    unsigned long unpaired;
+};
+
+// target in both eyes: pixel offsets from each image centre
+struct StereoDetection {
+    bool left = false, right = false;  // found in that eye
+    double leftX = 0.0, leftY = 0.0;
+    double rightX = 0.0, rightY = 0.0;
+    uint64_t leftPixels = 0, rightPixels = 0;
+    
+    // error that drives version: the mean of both eyes, or the one eye that
+    // still sees the target
+    bool cyclopean(double& errorX, double& errorY) const {
+        if (!left && !right) return false;
+        const double eyes = (left ? 1.0 : 0.0) + (right ? 1.0 : 0.0);
+        errorX = ((left ? leftX : 0.0) + (right ? rightX : 0.0)) / eyes;
+        errorY = ((left ? leftY : 0.0) + (right ? rightY : 0.0)) / eyes;
+        return true;
+    }
+};
+
+// runs the two eyes' detectors at the same time, so a stereo frame costs
+// about as long as a mono one. each detector needs a worker pool of its
+// own when it has more than one lane. the thread of the second eye's lane
+// runs threadStart once when it starts.
+// the eyes share their tilt, so one object lands on the same image row in
+// both; a right-eye detection off the left one's row is another object; it
+// is discarded and the right detector starts its search over
+class StereoDetector {
+public:
+    StereoDetector(TargetDetector& leftDetector, TargetDetector& rightDetector,
+                   std::function<void()> threadStart = nullptr);
+    
+    StereoDetection detect(const FrameRef& leftFrame, const FrameRef& rightFrame);
+    
+    // right-eye detections dropped for breaking the row constraint
+    unsigned long getMismatches() const { return mismatches; }
+    
+    static constexpr double ROW_TOLERANCE = 0.03;  // of the image height
+    
+private:
+    TargetDetector& leftDetector;
+    TargetDetector& rightDetector;
+    WorkerPool lanes;  // one per eye
+    unsigned long mismatches;
+};
+
+// target position in head-centred metres: x right, y up, z forward from
+// the midpoint between the eyes
+struct StereoTarget {
+    double x, y, z;
+    double distance;
+    double vergence;  // degrees that put both optical axes on the target
+};
+
+// triangulation for the iCub eyes: a shared tilt, and version and vergence
+// about parallel vertical axes on a fixed baseline, so the left eye looks
+// along version + vergence / 2 and the right along version - vergence / 2.
+// angles in degrees
+class StereoGeometry {
+public:
+    explicit StereoGeometry(double horizontalFov = 63.8, double baseline = BASELINE);
+    
+    // false when the rays do not meet in front of the eyes
+    bool triangulate(const StereoDetection& detection, size_t width,
+                     double version, double vergence, double tilt, StereoTarget& target) const;
+    
+    static constexpr double BASELINE = 0.068;    // metres between the eye centres
+    static constexpr double MIN_DISTANCE = 0.1;  // metres, nearer solutions are noise
+    
+private:
+    double horizontalFov;
+    double baseline;
+};
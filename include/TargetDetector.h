@@ -0,0 +1,98 @@
+#pragma once
+
+#include "BlobDetector.h"
+#include "FrameChangeDetector.h"
+#include "ImagePyramid.h"
+#include "ParallelSegmenter.h"
+#include "RoiTracker.h"
+
+// red target detection on raw rgb frames: roi tracking around the last
+// target, reacquisition on a subsampled pass for the centroid or on the
+// coarsest level of an image pyramid for blobs, with a full-resolution
+// refinement around the candidates, and row-band parallel full-frame scans
+// as the last resort.
+// unless the policy is Centroid, the red pixels are split into connected
+// blobs and the policy picks one of them; while locked, only the blobs
+// inside the roi window compete.
+// in incremental mode each frame is first compared with the previous one
+// tile by tile; while nothing changed where the frame would be searched, the
+// last result stands and no pixel is segmented. full-frame centroid scans
+// keep moments per tile and rescan only the tiles that changed
+class TargetDetector {
+public:
+    explicit TargetDetector(WorkerPool& pool, bool roiTracking = true,
+                            TargetPolicy policy = TargetPolicy::Largest);
+    
+    void reset();
+    bool isRoiTracking() const { return roiTracking; }
+    TargetPolicy getPolicy() const { return selector.getPolicy(); }
+    
+    // target colour, the red ratio test by default
+    void setClassifier(const ColorClassifier& colorClassifier);
+    const ColorClassifier& getClassifier() const { return classifier; }
+    
+    // threshold is the largest change of a colour byte that still counts as unchanged
+    void setIncremental(bool enabled, int threshold = FrameChangeDetector::THRESHOLD);
+    bool isIncremental() const { return incremental; }
+    
+    // frames seen, and those answered with the last result
+    uint64_t getFrames() const { return frames; }
+    uint64_t getReusedFrames() const { return reusedFrames; }
+    
+    // moments of the target, false when fewer than MIN_PIXELS were found
+    bool detect(const unsigned char* data, size_t rowStride, size_t width, size_t height,
+                SegmentMoments& moments);
+    
+    // blobs of the last detect() and the one that was chosen (-1 if none)
+    const std::vector<Blob>& getBlobs() const { return blobs; }
+    int getSelected() const { return selected; }
+    BlobSelector& getSelector() { return selector; }
+    
+    static constexpr uint64_t MIN_PIXELS = 50;   // minimum blob size
+    static constexpr size_t COARSE_STEP = 4;     // subsampling of the centroid reacquisition search
+    static constexpr size_t PYRAMID_LEVELS = 3;  // blob reacquisition runs at 1/4 resolution
+    static constexpr size_t MAX_CANDIDATES = 8;  // coarse blobs refined at full resolution
+    static constexpr size_t MAX_BACKOFF = 8;     // frames searched without comparing while the target moves
+
+private:
+    bool searchFrame(const unsigned char* data, size_t rowStride, const Region& frame,
+                     SegmentMoments& moments);
+    bool search(const unsigned char* data, size_t rowStride, const Region& frame,
+                SegmentMoments& moments);
+    bool searchBlobs(const unsigned char* data, size_t rowStride, const Region& frame,
+                     SegmentMoments& moments);
+    // full-resolution blobs inside the windows of the coarse candidates
+    void reacquireBlobs(const unsigned char* data, size_t rowStride, const Region& frame);
+    // where the next search starts: the roi window while locked, else the frame
+    Region searchedRegion(const Region& frame) const;
+    // compares the tiles of the searched region with their last frames; true if any changed
+    bool examine(const unsigned char* data, size_t rowStride, const Region& frame, const Region& searched);
+    // centroid of the whole frame, from the per-tile moments in incremental mode
+    SegmentMoments segmentFrame(const unsigned char* data, size_t rowStride, const Region& frame);
+    
+    WorkerPool& pool;
+    ColorClassifier classifier;
+    ParallelSegmenter segmenter;
+    BlobLabeler labeler;
+    BlobSelector selector;
+    RoiTracker roi;
+    ImagePyramid pyramid;
+    std::vector<Blob> blobs;
+    std::vector<Region> windows;
+    bool roiTracking;
+    int selected;
+    
+    // incremental mode
+    bool incremental;
+    FrameChangeDetector changes;
+    std::vector<unsigned char> dirtyTiles;    // changed since their moments were taken
+    std::vector<SegmentMoments> tileMoments;  // of the full-frame scans
+    std::vector<size_t> rescanTiles;
+    SegmentMoments frameMoments;              // sum of tileMoments
+    bool hasResult, lastFound;
+    SegmentMoments lastMoments;
+    uint32_t lastTrackedId;
+    bool checked;                // this frame was compared with the last
+    size_t skipChecks, backoff;  // frames left without comparing, and the last back-off
+    uint64_t frames, reusedFrames;
+};
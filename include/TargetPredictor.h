@@ -0,0 +1,69 @@
+#pragma once
+
+#include "GazeController.h"
+#include <cstddef>
+
+// constant-velocity kalman filter on the target direction in head-fixed
+// angles (gaze from the encoders plus the pixel offset), so the estimate is
+// not disturbed by the eyes' own motion. detections update it at their
+// capture time; the controller reads it every tick, extrapolated to when
+// the command will take effect. angles in degrees, times in seconds
+class TargetPredictor {
+public:
+    explicit TargetPredictor(double horizontalFov = 63.8);
+    
+    void reset();
+    
+    // encoder history, recorded every tick, to look up the gaze at capture time
+    void recordHead(double time, const GazeController::Encoders& head);
+    
+    // detection in a frame captured at time: pixel offset from the image centre
+    void measure(double time, double errorX, double errorY, size_t width);
+    
+    // pixel error expected at time for the given head pose; false while no
+    // target is tracked or the last detection is older than MAX_COAST
+    bool predictError(double time, const GazeController::Encoders& head,
+                      double& errorX, double& errorY) const;
+    
+    bool isTracking(double time) const;
+    
+    // target velocity estimate, degrees/s
+    double getVelocityAzimuth() const { return azimuth.velocity; }
+    double getVelocityElevation() const { return elevation.velocity; }
+    
+    static constexpr double MEASUREMENT_NOISE = 0.25;    // degrees, one sigma
+    static constexpr double ACCELERATION_NOISE = 400.0;  // degrees^2/s^3, white acceleration
+    static constexpr double INITIAL_VELOCITY = 30.0;     // degrees/s, one sigma
+    static constexpr double GATE = 6.0;                  // degrees, larger jumps restart the filter
+    static constexpr double MAX_COAST = 0.3;             // seconds without a detection
+    
+private:
+    struct Axis {
+        double position, velocity;
+        double p00, p01, p11;  // covariance
+        
+        void init(double z);
+        void predict(double dt);
+        void update(double z);
+    };
+    
+    struct HeadSample {
+        double time;
+        double azimuth, elevation;
+    };
+    
+    // gaze direction at time, interpolated from the encoder history
+    bool gazeAt(double time, double& gazeAzimuth, double& gazeElevation) const;
+    
+    double horizontalFov;
+    double focal;  // pixels per radian, from the width of the last frame
+    
+    Axis azimuth, elevation;
+    bool initialized;
+    double filterTime;
+    double lastMeasurement;
+    
+    static constexpr size_t HISTORY = 32;  // ticks of encoder history
+    HeadSample history[HISTORY];
+    size_t historyCount, historyNext;
+};
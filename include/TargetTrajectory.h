@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+// seeded target motion for experiments, so two runs or two controller
+// versions see exactly the same target. positions are in the caller's units
+// (metres in the simulator world, degrees in the benchmarks) and stay inside
+// centre +- amplitude on each axis
+enum class TrajectoryKind {
+    Jumps,      // teleports between random points, one per trial
+    Sweep,      // back and forth along x at constant speed
+    Sine,       // sinusoid along x
+    Lissajous,  // x and y sinusoids at a 1 : 0.6 frequency ratio
+    Walk        // random walk at constant speed, turning smoothly
+};
+
+const char* trajectoryKindName(TrajectoryKind kind);
+bool parseTrajectoryKind(const std::string& name, TrajectoryKind& kind);
+
+struct TrajectorySettings {
+    TrajectoryKind kind = TrajectoryKind::Lissajous;
+    unsigned seed = 1;
+    double centreX = 0.0, centreY = 0.0;
+    double amplitudeX = 1.0, amplitudeY = 0.5;
+    double speed = 1.0;                    // units/s, the peak along x for the sinusoids
+    double minJump = 0.2, maxJump = 0.3;   // step on each axis between jumps
+};
+
+class TargetTrajectory {
+public:
+    explicit TargetTrajectory(const TrajectorySettings& settings);
+    
+    const TrajectorySettings& getSettings() const { return settings; }
+    bool isContinuous() const { return settings.kind != TrajectoryKind::Jumps; }
+    
+    // position t seconds after the start; random paths are generated in
+    // order on a fixed time grid, so a point depends only on t and the seed,
+    // never on when or how often it was asked for
+    void at(double t, double& x, double& y);
+    
+    // position of jump i, the first one starts from the centre
+    void jump(size_t i, double& x, double& y);
+    
+    static constexpr double WALK_STEP = 0.01;  // seconds between random walk points
+    static constexpr double WALK_TURN = 2.0;   // radians/s, spread of the heading changes
+    static constexpr int MAX_JUMP_TRIES = 100;
+
+private:
+    struct Point {
+        double x, y;
+    };
+    
+    void extendWalk(size_t points);
+    void extendJumps(size_t count);
+    
+    TrajectorySettings settings;
+    std::mt19937 rng;
+    std::normal_distribution<double> turn;  // kept, it caches half of each pair it draws
+    std::vector<Point> path;  // random walk or jump points generated so far
+    double heading;           // of the random walk's last step
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "SpmcRing.h"
+#include <chrono>
+#include <cstdint>
+
+// stages of one control tick, in execution order
+enum TelemetryStage {
+    STAGE_FRAME,     // taking the newest frame from the grabber
+    STAGE_SEGMENT,   // target detection
+    STAGE_CONTROL,   // pid update
+    STAGE_ENCODERS,  // encoder read
+    STAGE_COMMAND,   // joint commands
+    STAGE_COUNT
+};
+
+inline const char* telemetryStageName(int stage) {
+    static const char* const names[STAGE_COUNT] = {
+        "frame", "segment", "control", "encoders", "command"
+    };
+    return stage >= 0 && stage < STAGE_COUNT ? names[stage] : "unknown";
+}
+
+// one record per control tick
+struct TelemetrySample {
+    double timestamp;          // seconds, yarp clock
+    uint64_t tick;
+    double errorX, errorY;     // pixels
+    double eyeYawCommand, eyeTiltCommand;  // degrees
+    double eyeYaw, eyeTilt;    // encoders, degrees
+    double neckPitch, neckYaw; // encoders, degrees
+    uint32_t pixelCount;       // target pixels, 0 on predict-only ticks
+    uint32_t measured;         // 1 when the tick ran a vision update
+    float stageTime[STAGE_COUNT];  // seconds, 0 when the stage did not run
+    float tickTime;            // whole tick, seconds
+    float cameraLatency;       // frame envelope to command sent, seconds, 0 if unknown
+};
+
+// about 20 s of history at 50 Hz for readers that fall behind
+using TelemetryChannel = SpmcRing<TelemetrySample, 1024>;
+
+// lap timer for the stage timings
+class StageTimer {
+public:
+    void start() { first = last = Clock::now(); }
+    
+    // seconds since the previous lap or start
+    float lap() {
+        const Clock::time_point now = Clock::now();
+        const float elapsed = std::chrono::duration<float>(now - last).count();
+        last = now;
+        return elapsed;
+    }
+    
+    // seconds since start
+    float total() const {
+        return std::chrono::duration<float>(Clock::now() - first).count();
+    }
+    
+private:
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point first;
+    Clock::time_point last;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <yarp/os/all.h>
+#include "Telemetry.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+using namespace yarp::os;
+
+// one telemetry batch on the wire: the bytes of telemetrywire::encode,
+// length-prefixed so a reader never trusts more than it was sent
+class TelemetryBatch : public Portable {
+public:
+    std::vector<unsigned char> bytes;
+    
+    bool read(ConnectionReader& connection) override;
+    bool write(ConnectionWriter& connection) const override;
+    
+    static constexpr size_t MAX_BYTES = 8 << 20;
+};
+
+// exports the control loop's telemetry ring on an output port. a thread of
+// its own drains the ring every period and sends what it found in batches,
+// so the control thread only ever publishes to the ring; nothing is
+// encoded while no one is connected. a host running several controllers
+// adds one ring per instance and the batches carry the instance number
+class TelemetryPublisher : public PeriodicThread {
+public:
+    // source 0 for a single controller
+    TelemetryPublisher(const TelemetryChannel& telemetry, double period = PERIOD);
+    explicit TelemetryPublisher(double period = PERIOD);
+    
+    // before open
+    void addSource(const TelemetryChannel& telemetry, uint32_t source);
+    
+    bool open(const std::string& portName);
+    void close();
+    
+    uint64_t getBatches() const { return batches.load(std::memory_order_relaxed); }
+    uint64_t getLostSamples() const { return lostSamples.load(std::memory_order_relaxed); }
+    
+    static constexpr double PERIOD = 0.1;  // seconds, five ticks a batch at 50 Hz
+
+protected:
+    void run() override;
+
+private:
+    struct Source {
+        const TelemetryChannel* telemetry;
+        uint32_t id;
+        TelemetryChannel::Cursor cursor;
+    };
+    
+    std::vector<Source> sources;
+    BufferedPort<TelemetryBatch> port;
+    std::vector<TelemetrySample> pending;
+    std::atomic<uint64_t> batches;
+    std::atomic<uint64_t> lostSamples;
+};
+
+// the other end, in a consumer process: decodes each batch on the port's
+// thread and republishes the records of one source to a local ring, which
+// readers drain as they would the controller's own
+class TelemetryReceiver : public TypedReaderCallback<TelemetryBatch> {
+public:
+    explicit TelemetryReceiver(TelemetryChannel& telemetry, uint32_t source = 0);
+    
+    bool open(const std::string& portName);
+    void close();
+    
+    // ticks missing between consecutive batches, and batches that did not decode
+    uint64_t getMissedTicks() const { return missedTicks.load(std::memory_order_relaxed); }
+    uint64_t getBadBatches() const { return badBatches.load(std::memory_order_relaxed); }
+    
+    using TypedReaderCallback<TelemetryBatch>::onRead;
+    void onRead(TelemetryBatch& batch) override;
+
+private:
+    TelemetryChannel& telemetry;
+    uint32_t source;
+    BufferedPort<TelemetryBatch> port;
+    std::vector<TelemetrySample> decoded;
+    bool hasTick;
+    uint64_t lastTick;
+    std::atomic<uint64_t> missedTicks;
+    std::atomic<uint64_t> badBatches;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Telemetry.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// compact layout for shipping telemetry to other processes: a batch header
+// followed by one fixed-size record per tick, with times and ticks stored
+// as offsets from the header's first record and everything else as 32-bit
+// fields, 72 bytes against the 120 of a TelemetrySample. the header names
+// the controller instance the batch came from, so several can share a
+// port. host byte order; a reader with the other order rejects the batch
+// on its magic
+namespace telemetrywire {
+
+struct BatchHeader {
+    char magic[4];        // "GZTB"
+    uint16_t version;
+    uint16_t count;       // records that follow
+    uint32_t source;      // controller instance, 0 for a single controller
+    uint32_t reserved;
+    uint64_t firstTick;
+    double firstTime;     // seconds, yarp clock
+};
+
+struct Record {
+    float time;           // seconds after firstTime
+    uint32_t tick;        // ticks after firstTick
+    float errorX, errorY;
+    float eyeYawCommand, eyeTiltCommand;
+    float eyeYaw, eyeTilt;
+    float neckPitch, neckYaw;
+    uint32_t pixels;      // pixel count, MEASURED_BIT set on vision ticks
+    float stageTime[STAGE_COUNT];
+    float tickTime;
+    float cameraLatency;
+};
+
+static_assert(sizeof(BatchHeader) == 32, "batch header must not be padded");
+static_assert(sizeof(Record) == 72, "record must not be padded");
+
+constexpr uint16_t VERSION = 2;
+constexpr uint32_t MEASURED_BIT = 1u << 31;
+constexpr size_t MAX_BATCH = 0xffff;  // records per batch
+
+// replaces out with one batch of count records, count <= MAX_BATCH
+void encode(const TelemetrySample* samples, size_t count, std::vector<unsigned char>& out,
+            uint32_t source = 0);
+
+// appends the batch's records to samples and sets source; false, and
+// nothing touched, if the bytes are not a whole batch of this version
+bool decode(const unsigned char* data, size_t size, std::vector<TelemetrySample>& samples,
+            uint32_t& source);
+
+} // namespace telemetrywire
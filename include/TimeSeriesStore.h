@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// fixed-capacity columnar ring of time-stamped rows for live plots. next to
+// the raw rows it keeps min/max summaries of every column over blocks of
+// FANOUT, FANOUT^2, ... rows, so the envelope of any time range costs a few
+// hundred reads however many rows it covers. everything is allocated up
+// front; once full, each row overwrites the oldest one.
+// rows must arrive in time order
+class TimeSeriesStore {
+public:
+    // extremes of one column over a bucket of time
+    struct Bucket {
+        double time;  // bucket start
+        float min, max;
+    };
+    
+    // capacity is rounded up to whole blocks of the coarsest summary level
+    TimeSeriesStore(size_t columns, size_t capacity);
+    
+    void clear();
+    
+    // values holds one entry per column
+    void append(double time, const float* values);
+    
+    size_t columns() const { return columnCount; }
+    size_t capacity() const { return rowCapacity; }
+    size_t size() const { return static_cast<size_t>(next - oldest()); }
+    bool empty() const { return next == 0; }
+    double firstTime() const { return timeAt(oldest()); }
+    double lastTime() const { return timeAt(next - 1); }
+    
+    // one bucket per interval [start + i * width, start + (i + 1) * width)
+    // that holds rows, in time order; returns how many were written to out
+    size_t decimate(size_t column, double start, double width, size_t buckets, Bucket* out) const;
+    
+    // extremes of a column over the rows with start <= time < end; false if none
+    bool envelope(size_t column, double start, double end, float& min, float& max) const;
+    
+    static constexpr size_t FANOUT = 8;
+    static constexpr size_t MAX_LEVELS = 8;  // raw rows plus up to seven summary levels
+    
+private:
+    struct Level {
+        size_t blockRows;  // rows per block, FANOUT^level
+        size_t blocks;     // ring slots
+        std::unique_ptr<float[]> min, max;  // [column * blocks + slot]
+    };
+    
+    uint64_t oldest() const { return next > rowCapacity ? next - rowCapacity : 0; }
+    double timeAt(uint64_t row) const { return times[row % rowCapacity]; }
+    
+    // first row with time >= t, within [oldest, next]
+    uint64_t lowerBound(double t) const;
+    // extremes of a column over rows [begin, end), begin < end
+    void rangeEnvelope(size_t column, uint64_t begin, uint64_t end, float& min, float& max) const;
+    
+    size_t columnCount;
+    size_t rowCapacity;
+    std::unique_ptr<double[]> times;
+    std::unique_ptr<float[]> values;  // [column * capacity + slot], one column after another
+    Level levels[MAX_LEVELS];         // levels[0] unused, the raw rows stand in
+    size_t levelCount;
+    uint64_t next;  // absolute index of the next row
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// persistent pool of worker threads for data-parallel loops. threads are
+// spawned once and park on a condition variable between jobs; the calling
+// thread takes part in every job, so a pool of size 1 runs inline
+class WorkerPool {
+public:
+    // lanes = 0 picks one lane per hardware thread; every worker runs
+    // threadStart first, e.g. to take on the caller's scheduling
+    explicit WorkerPool(size_t lanes = 0, std::function<void()> threadStart = nullptr);
+    ~WorkerPool();
+    
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    
+    // calling thread plus workers
+    size_t size() const { return workers.size() + 1; }
+    
+    // runs task(i) for every i in [0, count) and returns once all are done.
+    // the pool serves one caller at a time; a caller that finds it busy, e.g.
+    // another controller sharing it, runs its job on its own thread instead
+    // of waiting
+    void parallelFor(size_t count, const std::function<void(size_t)>& task);
+    
+private:
+    void workerLoop(std::function<void()> threadStart);
+    void drain();
+    
+    std::vector<std::thread> workers;
+    std::mutex jobMutex;  // one job at a time
+    
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t)>* task;
+    size_t taskCount;
+    unsigned long generation;
+    size_t busyWorkers;
+    bool stopping;
+    
+    std::atomic<size_t> nextIndex;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <yarp/os/all.h>
+#include "TargetTrajectory.h"
+#include <atomic>
+#include <string>
+
+using namespace yarp::os;
+
+// the target sphere in the simulator world. creating the sphere and single
+// jumps go through rpc and wait for the reply; continuous motion is streamed
+// by a thread of its own as one-way "world set ssph" commands on a second
+// connection, so an update never waits for the previous one to be answered
+class WorldDriver : public PeriodicThread {
+public:
+    WorldDriver(const TrajectorySettings& settings, double rate = RATE);
+    
+    // connects to the simulator's world port under the given local prefix,
+    // waiting up to timeout seconds for the simulator to come up
+    bool open(const std::string& prefix, double timeout = 0.0, const std::string& worldPort = "/icubSim/world");
+    void close();
+    
+    // replaces everything in the world with the sphere at the start of the trajectory
+    bool createSphere();
+    bool moveSphere(double x, double y);
+    
+    // streams the trajectory from now on, with t = 0 at the call
+    bool startMotion();
+    void stopMotion();
+    
+    TargetTrajectory& getTrajectory() { return trajectory; }
+    uint64_t getUpdates() const { return updates.load(std::memory_order_relaxed); }
+    
+    static constexpr double RATE = 50.0;  // Hz, streamed updates
+    static constexpr double SPHERE_RADIUS = 0.04;
+    static constexpr double SPHERE_Z = 0.8;
+    static constexpr double POLL = 0.01;  // seconds between connection attempts while waiting
+
+protected:
+    bool threadInit() override;
+    void run() override;
+
+private:
+    // command words shared by the rpc and the streamed moves
+    static void addMove(Bottle& cmd, double x, double y);
+    
+    TargetTrajectory trajectory;
+    RpcClient rpcPort;
+    BufferedPort<Bottle> streamPort;
+    double startTime;
+    std::atomic<uint64_t> updates;
+};
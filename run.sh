@@ -12,11 +12,23 @@ is_running() {
 
 # Function to check if YARP is responding
 check_yarp() {
-    for i in {1..10}; do
+    for i in {1..50}; do
         if yarp detect | grep -q "FOUND"; then
             return 0
         fi
-        sleep 1
+        sleep 0.2
+    done
+    return 1
+}
+
+# Function to wait up to $2 seconds for a YARP port to exist
+wait_for_port() {
+    local tries=$(( $2 * 10 ))
+    for ((i = 0; i < tries; i++)); do
+        if yarp exists "$1" > /dev/null 2>&1; then
+            return 0
+        fi
+        sleep 0.1
     done
     return 1
 }
@@ -82,40 +94,37 @@ fi
 export LIBGL_ALWAYS_SOFTWARE=1
 export MESA_GL_VERSION_OVERRIDE=3.3
 
+# Seconds a slow simulator boot is given, by this script and by gaze_control
+SIMULATOR_TIMEOUT=30
+
 # Start iCub simulator in new terminal
 echo "Starting iCub simulator..."
 open_terminal "iCub Simulator" "iCub_SIM"
 
-# Wait for simulator to be ready by checking for the world port
-echo "Waiting for simulator to be ready..."
-for i in {1..20}; do
-    if yarp exists /icubSim/world; then
-        break
-    fi
-    sleep 1
-    if [ $i -eq 20 ]; then
-        echo "Error: Simulator failed to start properly"
-        "$SCRIPT_DIR/shutdown.sh"
-        exit 1
-    fi
-done
-
-# Additional delay for simulator initialization
-sleep 5
+# Run our gaze tracking program in new terminal right away, it waits for
+# the simulator's world, head and camera ports itself, as long as we do
+echo "Starting gaze tracking program..."
+# Use quotes to handle spaces in paths
+open_terminal "Gaze Tracking" "cd \"$SCRIPT_DIR/build/bin\" && ./gaze_control --startup_timeout $SIMULATOR_TIMEOUT"
 
 # Start yarpview for camera feed
 echo "Starting camera view..."
 open_terminal "Camera View" "yarpview --name /viewer"
-sleep 2
 
-# Connect camera to viewer
+# Connect camera to viewer as soon as both ports exist
+echo "Waiting for simulator to be ready..."
+if ! wait_for_port /icubSim/cam/left $SIMULATOR_TIMEOUT || ! wait_for_port /viewer 10; then
+    echo "Error: Simulator failed to start properly"
+    "$SCRIPT_DIR/shutdown.sh"
+    exit 1
+fi
 echo "Connecting camera feed..."
 yarp connect /icubSim/cam/left /viewer
-
-# Run our gaze tracking program in new terminal
-echo "Starting gaze tracking program..."
-# Use quotes to handle spaces in paths
-open_terminal "Gaze Tracking" "cd \"$SCRIPT_DIR/build/bin\" && ./gaze_control"
+if ! is_running "gaze_control"; then
+    echo "Error: Gaze tracking program stopped during startup"
+    "$SCRIPT_DIR/shutdown.sh"
+    exit 1
+fi
 
 echo "All components started!"
 echo "To shut down all components, run: ./shutdown.sh"
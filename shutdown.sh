@@ -20,12 +20,17 @@ echo "Shutting down iCub Eye Tracking System..."
 
 # Close YARP ports
 kill_yarp_port "/gazeControl/world:o"
+kill_yarp_port "/gazeControl/worldStream:o"
 kill_yarp_port "/gazeControl/command:o"
 kill_yarp_port "/gazeControl/rpc:o"
 kill_yarp_port "/gazeControl/img:i"
+kill_yarp_port "/gazeControl/rpc"
+kill_yarp_port "/gazeControl/telemetry:o"
+kill_yarp_port "/gazeHost/telemetry:o"
 kill_yarp_port "/gazeControl/stateExt:i"
 
 # Kill Qt window and main program
+kill_process "gaze_plotter"
 kill_process "gaze_control"
 
 # Kill simulator
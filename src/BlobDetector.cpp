@@ -0,0 +1,243 @@
+#include "BlobDetector.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// pixel sum of x over [x0, x1)
+inline uint64_t sumRange(uint64_t x0, uint64_t x1) {
+    return (x0 + x1 - 1) * (x1 - x0) / 2;
+}
+
+} // namespace
+
+BlobLabeler::BlobLabeler(WorkerPool& pool, size_t bandsPerLane) :
+    pool(pool),
+    classifier(nullptr),
+    bands(pool.size() * std::max<size_t>(1, bandsPerLane)) {
+}
+
+void BlobLabeler::encodeRows(const unsigned char* data, size_t rowStride, const Region& region,
+                             std::vector<Run>& runs) const {
+    static const ColorClassifier red;
+    const ColorClassifier& test = classifier ? *classifier : red;
+    
+    for (size_t y = region.y0; y < region.y1; y++) {
+        // the simd kernels skip rows without a hit at full speed
+        if (test.isFastPath() && test.segment(data, rowStride, Region{region.x0, y, region.x1, y + 1}).count == 0) {
+            continue;
+        }
+        
+        const unsigned char* row = data + y * rowStride;
+        size_t x = region.x0;
+        while (x < region.x1) {
+            while (x < region.x1 && !test.test(row + 3 * x)) x++;
+            if (x == region.x1) break;
+            const size_t start = x;
+            while (x < region.x1 && test.test(row + 3 * x)) x++;
+            runs.push_back(Run{static_cast<uint32_t>(start), static_cast<uint32_t>(x),
+                               static_cast<uint32_t>(y), 0});
+        }
+    }
+}
+
+uint32_t BlobLabeler::find(uint32_t i) {
+    // path halving
+    while (runs[i].parent != i) {
+        runs[i].parent = runs[runs[i].parent].parent;
+        i = runs[i].parent;
+    }
+    return i;
+}
+
+void BlobLabeler::unite(uint32_t a, uint32_t b) {
+    a = find(a);
+    b = find(b);
+    if (a == b) return;
+    // the older run stays the root
+    if (a < b) runs[b].parent = a;
+    else runs[a].parent = b;
+}
+
+std::vector<Blob>& BlobLabeler::label(const unsigned char* data, size_t rowStride,
+                                      const Region& region, uint64_t minArea) {
+    runs.clear();
+    blobs.clear();
+    if (region.empty()) return blobs;
+    
+    // run-length encode the rows, in bands when the region is tall enough
+    const size_t rows = region.height();
+    const size_t bandCount = std::min(bands.size(), rows / MIN_BAND_ROWS);
+    if (bandCount <= 1 || pool.size() == 1) {
+        encodeRows(data, rowStride, region, runs);
+    } else {
+        pool.parallelFor(bandCount, [&](size_t band) {
+            Region slice = region;
+            slice.y0 = region.y0 + rows * band / bandCount;
+            slice.y1 = region.y0 + rows * (band + 1) / bandCount;
+            bands[band].runs.clear();
+            encodeRows(data, rowStride, slice, bands[band].runs);
+        });
+        for (size_t band = 0; band < bandCount; band++) {
+            runs.insert(runs.end(), bands[band].runs.begin(), bands[band].runs.end());
+        }
+    }
+    if (runs.empty()) return blobs;
+    
+    // runs are ordered by row, then column: sweep each row against the one above
+    for (uint32_t i = 0; i < runs.size(); i++) runs[i].parent = i;
+    size_t previousStart = 0, previousEnd = 0;  // runs of the row above
+    size_t rowStart = 0;
+    while (rowStart < runs.size()) {
+        const uint32_t y = runs[rowStart].y;
+        size_t rowEnd = rowStart;
+        while (rowEnd < runs.size() && runs[rowEnd].y == y) rowEnd++;
+        
+        const bool adjacent = previousEnd > previousStart && runs[previousStart].y + 1 == y;
+        if (adjacent) {
+            size_t above = previousStart;
+            for (size_t i = rowStart; i < rowEnd; i++) {
+                // 8-connectivity: diagonal neighbours touch too
+                while (above < previousEnd && runs[above].x1 < runs[i].x0) above++;
+                for (size_t j = above; j < previousEnd && runs[j].x0 <= runs[i].x1; j++) {
+                    unite(static_cast<uint32_t>(i), static_cast<uint32_t>(j));
+                }
+            }
+        }
+        previousStart = rowStart;
+        previousEnd = rowEnd;
+        rowStart = rowEnd;
+    }
+    
+    // sum moments and boxes per root
+    blobOfRoot.assign(runs.size(), -1);
+    for (uint32_t i = 0; i < runs.size(); i++) {
+        const uint32_t root = find(i);
+        if (blobOfRoot[root] < 0) {
+            blobOfRoot[root] = static_cast<int32_t>(blobs.size());
+            Blob blob;
+            blob.box = Region{runs[i].x0, runs[i].y, runs[i].x1, runs[i].y + 1};
+            blobs.push_back(blob);
+        }
+        
+        const Run& run = runs[i];
+        Blob& blob = blobs[blobOfRoot[root]];
+        const uint64_t length = run.x1 - run.x0;
+        blob.moments.count += length;
+        blob.moments.sumX += sumRange(run.x0, run.x1);
+        blob.moments.sumY += length * run.y;
+        blob.box.x0 = std::min<size_t>(blob.box.x0, run.x0);
+        blob.box.x1 = std::max<size_t>(blob.box.x1, run.x1);
+        blob.box.y1 = std::max<size_t>(blob.box.y1, run.y + 1);
+    }
+    
+    blobs.erase(std::remove_if(blobs.begin(), blobs.end(),
+                               [minArea](const Blob& blob) { return blob.area() < minArea; }),
+                blobs.end());
+    std::sort(blobs.begin(), blobs.end(),
+              [](const Blob& a, const Blob& b) { return a.area() > b.area(); });
+    return blobs;
+}
+
+const char* targetPolicyName(TargetPolicy policy) {
+    switch (policy) {
+        case TargetPolicy::Centroid: return "centroid";
+        case TargetPolicy::Largest: return "largest";
+        case TargetPolicy::Nearest: return "nearest";
+        case TargetPolicy::Tracked: return "tracked";
+    }
+    return "unknown";
+}
+
+bool parseTargetPolicy(const std::string& name, TargetPolicy& policy) {
+    for (TargetPolicy candidate : {TargetPolicy::Centroid, TargetPolicy::Largest,
+                                   TargetPolicy::Nearest, TargetPolicy::Tracked}) {
+        if (name == targetPolicyName(candidate)) {
+            policy = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+BlobSelector::BlobSelector(TargetPolicy policy) :
+    policy(policy),
+    trackedId(0) {
+    reset();
+}
+
+void BlobSelector::reset() {
+    previous.clear();
+    nextId = 1;
+    trackedId = 0;
+    hasLast = false;
+    lastX = lastY = 0.0;
+}
+
+void BlobSelector::assignIds(std::vector<Blob>& blobs) {
+    // greedy matching, closest pairs first
+    struct Match {
+        double distance;
+        size_t blob, previous;
+    };
+    std::vector<Match> matches;
+    for (size_t i = 0; i < blobs.size(); i++) {
+        for (size_t j = 0; j < previous.size(); j++) {
+            const double distance = std::hypot(blobs[i].centerX() - previous[j].x,
+                                               blobs[i].centerY() - previous[j].y);
+            if (distance <= previous[j].gate) matches.push_back(Match{distance, i, j});
+        }
+    }
+    std::sort(matches.begin(), matches.end(),
+              [](const Match& a, const Match& b) { return a.distance < b.distance; });
+    
+    for (Blob& blob : blobs) blob.id = 0;
+    std::vector<bool> taken(previous.size(), false);
+    for (const Match& match : matches) {
+        if (blobs[match.blob].id != 0 || taken[match.previous]) continue;
+        blobs[match.blob].id = previous[match.previous].id;
+        taken[match.previous] = true;
+    }
+    
+    previous.clear();
+    for (Blob& blob : blobs) {
+        if (blob.id == 0) blob.id = nextId++;
+        const double radius = std::sqrt(blob.area() / M_PI);
+        previous.push_back(Previous{blob.id, blob.centerX(), blob.centerY(),
+                                    MIN_GATE + GATE_RADII * radius});
+    }
+}
+
+int BlobSelector::select(std::vector<Blob>& blobs) {
+    assignIds(blobs);
+    if (blobs.empty()) return -1;
+    
+    int chosen = -1;
+    if (policy == TargetPolicy::Tracked) {
+        const uint32_t id = trackedId.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < blobs.size(); i++) {
+            if (blobs[i].id == id) chosen = static_cast<int>(i);
+        }
+    }
+    
+    if (chosen < 0 && hasLast && policy != TargetPolicy::Largest && policy != TargetPolicy::Centroid) {
+        double best = std::numeric_limits<double>::max();
+        for (size_t i = 0; i < blobs.size(); i++) {
+            const double distance = std::hypot(blobs[i].centerX() - lastX, blobs[i].centerY() - lastY);
+            if (distance < best) {
+                best = distance;
+                chosen = static_cast<int>(i);
+            }
+        }
+    }
+    
+    // blobs come sorted, the largest is first
+    if (chosen < 0) chosen = 0;
+    
+    trackedId.store(blobs[chosen].id, std::memory_order_relaxed);
+    hasLast = true;
+    lastX = blobs[chosen].centerX();
+    lastY = blobs[chosen].centerY();
+    return chosen;
+}
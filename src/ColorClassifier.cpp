@@ -0,0 +1,209 @@
+#include "ColorClassifier.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+bool inRange(double value, double low, double high) {
+    return value >= low && value <= high;
+}
+
+} // namespace
+
+bool ColorRule::matches(int r, int g, int b) const {
+    switch (type) {
+        case RATIO: {
+            const int c[3] = {r, g, b};
+            const int other = channel == 0 ? 1 : 0;
+            const int last = channel == 2 ? 1 : 2;
+            return c[channel] > factor * c[other] && c[channel] > factor * c[last];
+        }
+        case HSV: {
+            const int max = std::max(r, std::max(g, b));
+            const int min = std::min(r, std::min(g, b));
+            const double v = max / 255.0;
+            const double s = max > 0 ? static_cast<double>(max - min) / max : 0.0;
+            double h = 0.0;
+            if (max > min) {
+                const double d = max - min;
+                if (max == r) h = 60.0 * std::fmod((g - b) / d + 6.0, 6.0);
+                else if (max == g) h = 60.0 * ((b - r) / d + 2.0);
+                else h = 60.0 * ((r - g) / d + 4.0);
+            }
+            const bool hue = low[0] <= high[0] ? inRange(h, low[0], high[0])
+                                               : h >= low[0] || h <= high[0];
+            return hue && inRange(s, low[1], high[1]) && inRange(v, low[2], high[2]);
+        }
+        case YUV: {
+            // bt.601 full range
+            const double y = 0.299 * r + 0.587 * g + 0.114 * b;
+            const double u = -0.169 * r - 0.331 * g + 0.5 * b;
+            const double v = 0.5 * r - 0.419 * g - 0.081 * b;
+            return inRange(y, low[0], high[0]) && inRange(u, low[1], high[1]) && inRange(v, low[2], high[2]);
+        }
+    }
+    return false;
+}
+
+ColorClassifier::ColorClassifier() :
+    fastPath(true),
+    bits(0),
+    shift(0) {
+    rules.push_back(ColorRule());
+}
+
+bool ColorClassifier::setRules(const std::vector<ColorRule>& newRules, int newBits) {
+    if (newRules.empty() || newBits < 5 || newBits > 6) return false;
+    
+    bool accepts = false;
+    for (const ColorRule& rule : newRules) {
+        accepts = accepts || !rule.reject;
+        if (rule.type == ColorRule::RATIO && (rule.channel < 0 || rule.channel > 2)) return false;
+    }
+    if (!accepts) return false;
+    rules = newRules;
+    
+    // integer ratios have their own kernels
+    const ColorRule& first = rules.front();
+    ratio = RatioRule{first.channel, static_cast<int>(first.factor)};
+    fastPath = rules.size() == 1 && first.type == ColorRule::RATIO && !first.reject &&
+               first.factor == ratio.factor && ratio.valid();
+    if (fastPath) {
+        table.clear();
+        return true;
+    }
+    
+    // bake every colour cell at its centre
+    bits = newBits;
+    shift = 8 - bits;
+    const uint32_t cells = 1u << (3 * bits);
+    const int half = 1 << (shift - 1);
+    table.assign(cells / 64, 0);
+    for (uint32_t cell = 0; cell < cells; cell++) {
+        const int r = static_cast<int>((cell >> (2 * bits)) << shift) + half;
+        const int g = static_cast<int>(((cell >> bits) & ((1u << bits) - 1)) << shift) + half;
+        const int b = static_cast<int>((cell & ((1u << bits) - 1)) << shift) + half;
+        
+        bool accepted = false, rejected = false;
+        for (const ColorRule& rule : rules) {
+            if (!rule.matches(r, g, b)) continue;
+            if (rule.reject) rejected = true;
+            else accepted = true;
+        }
+        if (accepted && !rejected) table[cell >> 6] |= uint64_t(1) << (cell & 63);
+    }
+    return true;
+}
+
+bool ColorClassifier::load(const std::string& path, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    
+    std::vector<ColorRule> parsed;
+    int tableBits = 5;
+    std::string line;
+    for (int number = 1; std::getline(file, line); number++) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string verb;
+        if (!(words >> verb)) continue;
+        
+        const std::string where = path + ":" + std::to_string(number) + ": ";
+        if (verb == "bits") {
+            if (!(words >> tableBits)) {
+                error = where + "expected bits 5 or 6";
+                return false;
+            }
+            continue;
+        }
+        
+        ColorRule rule;
+        std::string type;
+        if ((verb != "accept" && verb != "reject") || !(words >> type)) {
+            error = where + "expected accept or reject and a rule type";
+            return false;
+        }
+        rule.reject = verb == "reject";
+        
+        bool ok = false;
+        if (type == "ratio") {
+            std::string channel;
+            rule.type = ColorRule::RATIO;
+            ok = static_cast<bool>(words >> channel >> rule.factor);
+            rule.channel = channel == "g" ? 1 : channel == "b" ? 2 : 0;
+            ok = ok && (channel == "r" || channel == "g" || channel == "b");
+        } else if (type == "hsv" || type == "yuv") {
+            rule.type = type == "hsv" ? ColorRule::HSV : ColorRule::YUV;
+            ok = static_cast<bool>(words >> rule.low[0] >> rule.high[0] >> rule.low[1]
+                                         >> rule.high[1] >> rule.low[2] >> rule.high[2]);
+        }
+        if (!ok) {
+            error = where + "malformed " + type + " rule";
+            return false;
+        }
+        parsed.push_back(rule);
+    }
+    
+    if (!setRules(parsed, tableBits)) {
+        error = path + ": needs at least one accept rule and bits 5 or 6";
+        return false;
+    }
+    return true;
+}
+
+std::string ColorClassifier::describe() const {
+    if (fastPath) {
+        static const char* channels[] = {"r", "g", "b"};
+        return std::string("ratio ") + channels[ratio.dominant] + " > " +
+               std::to_string(ratio.factor) + "x (simd)";
+    }
+    return std::to_string(rules.size()) + " rules, " + std::to_string(1u << (3 * bits)) + "-cell table";
+}
+
+SegmentMoments ColorClassifier::segment(const unsigned char* data, size_t rowStride,
+                                        const Region& region) const {
+    if (fastPath) return segmentRatio(data, rowStride, region, ratio);
+    
+    SegmentMoments moments;
+    for (size_t y = region.y0; y < region.y1; y++) {
+        const unsigned char* p = data + y * rowStride + 3 * region.x0;
+        uint64_t rowCount = 0, rowSumX = 0;
+        for (size_t x = region.x0; x < region.x1; x++, p += 3) {
+            if (test(p)) {
+                rowCount++;
+                rowSumX += x;
+            }
+        }
+        moments.count += rowCount;
+        moments.sumX += rowSumX;
+        moments.sumY += rowCount * y;
+    }
+    return moments;
+}
+
+SegmentMoments ColorClassifier::segmentSubsampled(const unsigned char* data, size_t rowStride,
+                                                  const Region& region, size_t step) const {
+    if (fastPath) return segmentRatioSubsampled(data, rowStride, region, ratio, step);
+    if (step <= 1) return segment(data, rowStride, region);
+    
+    SegmentMoments moments;
+    for (size_t y = region.y0; y < region.y1; y += step) {
+        const unsigned char* row = data + y * rowStride;
+        uint64_t rowCount = 0, rowSumX = 0;
+        for (size_t x = region.x0; x < region.x1; x += step) {
+            if (test(row + 3 * x)) {
+                rowCount++;
+                rowSumX += x;
+            }
+        }
+        moments.count += rowCount;
+        moments.sumX += rowSumX;
+        moments.sumY += rowCount * y;
+    }
+    return moments;
+}
@@ -0,0 +1,101 @@
+#include "ConvergenceMonitor.h"
+#include <chrono>
+
+ConvergenceMonitor::ConvergenceMonitor() :
+    trial(0),
+    armTime(0.0),
+    stretchStart(-1.0),
+    pending(false) {
+}
+
+void ConvergenceMonitor::setOptions(const Options& newOptions) {
+    std::lock_guard<std::mutex> lock(mutex);
+    options = newOptions;
+}
+
+ConvergenceMonitor::Options ConvergenceMonitor::getOptions() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return options;
+}
+
+uint64_t ConvergenceMonitor::arm(double now) {
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        id = ++trial;
+        armTime = now;
+        stretchStart = -1.0;
+        result = Result();
+        pending.store(true, std::memory_order_release);
+    }
+    // a waiter on the trial this one replaces sees it cancelled
+    decided.notify_all();
+    return id;
+}
+
+void ConvergenceMonitor::update(double now, double lastCapture, bool converged, bool holding) {
+    if (!pending.load(std::memory_order_acquire)) return;
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (result.outcome != Outcome::Pending) return;
+        
+        // a detection from before the arm time still shows the old target
+        const bool fresh = lastCapture >= armTime;
+        if (fresh && (stretchStart < 0.0 ? converged : holding)) {
+            if (stretchStart < 0.0) stretchStart = now;
+            if (now - stretchStart >= options.dwell) {
+                finish(Outcome::Settled, now);
+            }
+        } else {
+            stretchStart = -1.0;
+        }
+        
+        if (result.outcome == Outcome::Pending && now - armTime >= options.timeout) {
+            finish(Outcome::TimedOut, now);
+        }
+        if (result.outcome == Outcome::Pending) return;
+    }
+    decided.notify_all();
+}
+
+void ConvergenceMonitor::finish(Outcome outcome, double now) {
+    result.outcome = outcome;
+    result.elapsed = now - armTime;
+    result.settleTime = outcome == Outcome::Settled ? stretchStart - armTime : result.elapsed;
+    pending.store(false, std::memory_order_release);
+}
+
+bool ConvergenceMonitor::wait(uint64_t id, Result& trialResult, double maxWait) {
+    std::unique_lock<std::mutex> lock(mutex);
+    const auto done = [&] { return id != trial || result.outcome != Outcome::Pending; };
+    if (!decided.wait_for(lock, std::chrono::duration<double>(maxWait), done)) return false;
+    
+    if (id != trial) {
+        trialResult = Result();
+        trialResult.outcome = Outcome::Cancelled;
+    } else {
+        trialResult = result;
+    }
+    return true;
+}
+
+void ConvergenceMonitor::cancel() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (result.outcome != Outcome::Pending || !pending.load(std::memory_order_relaxed)) return;
+        result.outcome = Outcome::Cancelled;
+        pending.store(false, std::memory_order_release);
+    }
+    decided.notify_all();
+}
+
+const char* convergenceOutcomeName(ConvergenceMonitor::Outcome outcome) {
+    switch (outcome) {
+        case ConvergenceMonitor::Outcome::Pending: return "pending";
+        case ConvergenceMonitor::Outcome::Settled: return "settled";
+        case ConvergenceMonitor::Outcome::TimedOut: return "timed out";
+        case ConvergenceMonitor::Outcome::Cancelled: return "cancelled";
+    }
+    return "unknown";
+}
@@ -0,0 +1,137 @@
+#include "FrameChangeDetector.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GAZE_CHANGE_X86 1
+#else
+#define GAZE_CHANGE_X86 0
+#endif
+
+namespace {
+
+using RowComparer = bool (*)(const unsigned char* a, const unsigned char* b, size_t count,
+                             unsigned char threshold);
+
+// any byte of the two runs further apart than threshold
+bool rowDiffersScalar(const unsigned char* a, const unsigned char* b, size_t count,
+                      unsigned char threshold) {
+    for (size_t i = 0; i < count; i++) {
+        const int difference = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+        if (difference > threshold) return true;
+    }
+    return false;
+}
+
+#if GAZE_CHANGE_X86
+
+// |a - b| as the sum of the two saturating differences, one of which is
+// zero; whatever is left after subtracting the threshold is a change
+__attribute__((target("sse2")))
+bool rowDiffersSSE2(const unsigned char* a, const unsigned char* b, size_t count,
+                    unsigned char threshold) {
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold));
+    __m128i excess = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        const __m128i difference = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        excess = _mm_or_si128(excess, _mm_subs_epu8(difference, limit));
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(excess, _mm_setzero_si128())) != 0xffff) return true;
+    return rowDiffersScalar(a + i, b + i, count - i, threshold);
+}
+
+#endif
+
+RowComparer detectComparer() {
+#if GAZE_CHANGE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) return rowDiffersSSE2;
+#endif
+    return rowDiffersScalar;
+}
+
+} // namespace
+
+FrameChangeDetector::FrameChangeDetector(size_t tileSize, size_t step, int threshold) :
+    tileSize(std::max<size_t>(1, tileSize)),
+    step(std::max<size_t>(1, step)),
+    phase(0),
+    threshold(threshold),
+    width(0),
+    height(0),
+    columns(0),
+    rows(0) {
+}
+
+void FrameChangeDetector::reset() {
+    width = height = 0;
+}
+
+size_t FrameChangeDetector::update(const unsigned char* data, size_t rowStride, size_t frameWidth, size_t frameHeight,
+                                   const Region& area) {
+    const size_t rowBytes = frameWidth * 3;
+    
+    // new geometry: take everything as reference and report it all changed
+    if (frameWidth != width || frameHeight != height) {
+        width = frameWidth;
+        height = frameHeight;
+        columns = (width + tileSize - 1) / tileSize;
+        rows = (height + tileSize - 1) / tileSize;
+        reference.resize(rowBytes * height);
+        changed.assign(tileCount(), 1);
+        for (size_t y = 0; y < height; y++) {
+            std::memcpy(reference.data() + y * rowBytes, data + y * rowStride, rowBytes);
+        }
+        return tileCount();
+    }
+    
+    std::fill(changed.begin(), changed.end(), 0);
+    if (area.empty()) return 0;
+    const size_t tx1 = std::min(columns, (area.x1 + tileSize - 1) / tileSize);
+    const size_t ty1 = std::min(rows, (area.y1 + tileSize - 1) / tileSize);
+    
+    // tile by tile, leaving a tile at its first differing row
+    static const RowComparer rowDiffers = detectComparer();
+    const size_t first = phase;
+    phase = (phase + 1) % step;
+    const unsigned char limit = static_cast<unsigned char>(std::max(0, std::min(255, threshold)));
+    size_t count = 0;
+    for (size_t ty = area.y0 / tileSize; ty < ty1; ty++) {
+        for (size_t tx = area.x0 / tileSize; tx < tx1; tx++) {
+            const size_t tile = ty * columns + tx;
+            const Region region = tileRegion(tile);
+            const size_t offset = region.x0 * 3, bytes = region.width() * 3;
+            
+            size_t y = region.y0 + (first + step - region.y0 % step) % step;
+            while (y < region.y1 && !rowDiffers(data + y * rowStride + offset,
+                                                reference.data() + y * rowBytes + offset, bytes, limit)) {
+                y += step;
+            }
+            if (y >= region.y1) continue;
+            
+            // the changed tile becomes its own reference
+            changed[tile] = 1;
+            count++;
+            adopt(tile, data, rowStride);
+        }
+    }
+    return count;
+}
+
+void FrameChangeDetector::adopt(size_t tile, const unsigned char* data, size_t rowStride) {
+    const Region region = tileRegion(tile);
+    const size_t rowBytes = width * 3, offset = region.x0 * 3, bytes = region.width() * 3;
+    for (size_t y = region.y0; y < region.y1; y++) {
+        std::memcpy(reference.data() + y * rowBytes + offset, data + y * rowStride + offset, bytes);
+    }
+}
+
+Region FrameChangeDetector::tileRegion(size_t tile) const {
+    const size_t tx = tile % columns, ty = tile / columns;
+    return Region{tx * tileSize, ty * tileSize,
+                  std::min(width, (tx + 1) * tileSize), std::min(height, (ty + 1) * tileSize)};
+}
@@ -0,0 +1,78 @@
+#include "FrameGrabber.h"
+#include <cstring>
+#include <utility>
+
+FrameGrabber::FrameGrabber() :
+    pool(POOL_SLABS, 320, 240),  // the simulator cameras; other sizes grow the slabs once
+    scheduled(false),
+    fresh(false),
+    dropped(0),
+    recorder(nullptr) {
+}
+
+bool FrameGrabber::open(const std::string& portName) {
+    // never queue frames, the callback only ever sees the newest one
+    port.setStrict(false);
+    port.useCallback(*this);
+    return port.open(portName);
+}
+
+void FrameGrabber::close() {
+    port.interrupt();
+    port.close();
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    ready = FrameRef();
+    fresh = false;
+}
+
+FrameRef FrameGrabber::latest() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!fresh) return FrameRef();
+    fresh = false;
+    return std::move(ready);
+}
+
+void FrameGrabber::onRead(ImageOf<PixelRgb>& image) {
+    // yarp creates the port thread, so it can only be scheduled from inside
+    if (!scheduled) {
+        scheduled = true;
+        std::string error;
+        if (!schedule.isDefault() && !applyThreadSchedule(schedule, error)) {
+            yError() << port.getName() << error;
+        }
+    }
+    
+    // the only copy of the frame; every consumer shares this slab
+    FrameRef frame = pool.acquire(image.width(), image.height());
+    if (!frame) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    
+    // yarp may pad rows, the slab is packed
+    const size_t rowBytes = frame.rowStride();
+    const size_t imageStride = image.getRowSize();
+    const unsigned char* source = image.getRawImage();
+    if (imageStride == rowBytes) {
+        std::memcpy(frame.data(), source, rowBytes * frame.height());
+    } else {
+        for (size_t y = 0; y < frame.height(); y++) {
+            std::memcpy(frame.data() + y * rowBytes, source + y * imageStride, rowBytes);
+        }
+    }
+    port.getEnvelope(stamp);
+    frame.setTimestamp(stamp.isValid() ? stamp.getTime() : Time::now(), stamp.isValid());
+    
+    // recording holds a reference and never waits on the disk
+    SessionRecorder* sessionRecorder = recorder.load();
+    if (sessionRecorder) {
+        sessionRecorder->pushFrame(frame);
+    }
+    
+    // the frame this one replaces is released after the lock
+    std::lock_guard<std::mutex> lock(mutex);
+    std::swap(ready, frame);
+    if (fresh) dropped.fetch_add(1, std::memory_order_relaxed);
+    fresh = true;
+}
@@ -0,0 +1,53 @@
+#include "FramePool.h"
+#include <algorithm>
+
+FramePool::FramePool(size_t slabs, size_t width, size_t height) :
+    slabs(new FrameRef::Slab[std::max<size_t>(1, slabs)]),
+    count(std::max<size_t>(1, slabs)),
+    next(0),
+    exhausted(0) {
+    const size_t bytes = width * height * 3;
+    for (size_t i = 0; bytes > 0 && i < count; i++) {
+        this->slabs[i].pixels.reset(new unsigned char[bytes]);
+        this->slabs[i].capacity = bytes;
+    }
+}
+
+FrameRef FramePool::acquire(size_t width, size_t height) {
+    // start after the last slab handed out, so slabs are reused round robin
+    // and a just-released one is not fought over by the next acquire
+    const size_t start = next.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; i++) {
+        const size_t index = (start + i) % count;
+        FrameRef::Slab& slab = slabs[index];
+        int expected = 0;
+        if (!slab.refs.compare_exchange_strong(expected, 1, std::memory_order_acquire,
+                                               std::memory_order_relaxed)) {
+            continue;
+        }
+        next.store(index + 1, std::memory_order_relaxed);
+        
+        // nobody else can see the slab until this handle is copied
+        const size_t bytes = width * height * 3;
+        if (slab.capacity < bytes) {
+            slab.pixels.reset(new unsigned char[bytes]);
+            slab.capacity = bytes;
+        }
+        slab.width = width;
+        slab.height = height;
+        slab.timestamp = 0.0;
+        slab.stamped = false;
+        return FrameRef(&slab);
+    }
+    
+    exhausted.fetch_add(1, std::memory_order_relaxed);
+    return FrameRef();
+}
+
+size_t FramePool::available() const {
+    size_t free = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (slabs[i].refs.load(std::memory_order_relaxed) == 0) free++;
+    }
+    return free;
+}
@@ -0,0 +1,246 @@
+#include "GazeController.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// file names of the gains, in file order
+struct GainField {
+    const char* name;
+    double GazeGains::*value;
+};
+
+constexpr GainField GAIN_FIELDS[] = {
+    {"kp", &GazeGains::kp},
+    {"ki", &GazeGains::ki},
+    {"kd", &GazeGains::kd},
+    {"head_gain", &GazeGains::headGain},
+    {"max_integral", &GazeGains::maxIntegral},
+};
+
+double clampVelocity(double velocity) {
+    return std::max(-GazeController::MAX_EYE_VELOCITY, std::min(GazeController::MAX_EYE_VELOCITY, velocity));
+}
+
+} // namespace
+
+const char* eyeControlModeName(EyeControlMode mode) {
+    switch (mode) {
+        case EyeControlMode::Position: return "position";
+        case EyeControlMode::Velocity: return "velocity";
+    }
+    return "unknown";
+}
+
+bool parseEyeControlMode(const std::string& name, EyeControlMode& mode) {
+    for (EyeControlMode candidate : {EyeControlMode::Position, EyeControlMode::Velocity}) {
+        if (name == eyeControlModeName(candidate)) {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GazeGains::load(const std::string& path, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    
+    GazeGains parsed = *this;
+    std::string line;
+    for (int number = 1; std::getline(file, line); number++) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string name;
+        if (!(words >> name)) continue;
+        
+        const std::string where = path + ":" + std::to_string(number) + ": ";
+        const GainField* field = nullptr;
+        for (const GainField& candidate : GAIN_FIELDS) {
+            if (name == candidate.name) field = &candidate;
+        }
+        if (!field) {
+            error = where + "unknown gain " + name;
+            return false;
+        }
+        if (!(words >> parsed.*(field->value))) {
+            error = where + "expected a value for " + name;
+            return false;
+        }
+    }
+    
+    if (!parsed.isValid()) {
+        error = path + ": gains must be finite and not negative";
+        return false;
+    }
+    *this = parsed;
+    return true;
+}
+
+bool GazeGains::save(const std::string& path, std::string& error) const {
+    std::ofstream file(path);
+    if (!file) {
+        error = "cannot write " + path;
+        return false;
+    }
+    file.precision(6);
+    for (const GainField& field : GAIN_FIELDS) {
+        file << field.name << " " << this->*(field.value) << "\n";
+    }
+    if (!file) {
+        error = "failed to write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool GazeGains::isValid() const {
+    for (const GainField& field : GAIN_FIELDS) {
+        const double value = this->*(field.value);
+        if (!std::isfinite(value) || value < 0.0) return false;
+    }
+    return true;
+}
+
+std::string GazeGains::describe() const {
+    std::ostringstream text;
+    text.precision(4);
+    for (const GainField& field : GAIN_FIELDS) {
+        text << (&field == GAIN_FIELDS ? "" : " ") << field.name << " " << this->*(field.value);
+    }
+    return text.str();
+}
+
+GazeController::GazeController() : mode(EyeControlMode::Position) {
+    reset();
+}
+
+void GazeController::setMode(EyeControlMode eyeMode) {
+    mode = eyeMode;
+    reset();
+}
+
+void GazeController::reset() {
+    eyeTiltPosition = eyeYawPosition = 0.0;
+    gazeYawTarget = gazeTiltTarget = 0.0;
+    errX = errY = 0;
+    lastErrX = lastErrY = 0;
+    integralX = integralY = 0.0;
+    degX = degY = 0.0;
+    vergencePosition = 0.0;
+    vergencePending = false;
+}
+
+void GazeController::updateError(int errorX, int errorY) {
+    errX = errorX;
+    errY = errorY;
+    
+    // update integral terms with anti-windup
+    integralX += errX;
+    integralY += errY;
+    
+    // apply anti-windup by clamping integral terms
+    integralX = std::max(-gains.maxIntegral, std::min(gains.maxIntegral, integralX));
+    integralY = std::max(-gains.maxIntegral, std::min(gains.maxIntegral, integralY));
+    
+    // pid control
+    degX = errX * gains.kp +              // proportional
+           integralX * gains.ki +         // integral
+           (lastErrX - errX) * gains.kd;  // derivative
+    
+    degY = errY * gains.kp +              // proportional
+           integralY * gains.ki +         // integral
+           (lastErrY - errY) * gains.kd;  // derivative
+    
+    // store errors for derivative control
+    lastErrX = errX;
+    lastErrY = errY;
+}
+
+void GazeController::updateVergence(double vergence) {
+    vergence = std::max(0.0, std::min(MAX_VERGENCE, vergence));
+    vergencePosition += VERGENCE_GAIN * (vergence - vergencePosition);
+    vergencePending = true;
+}
+
+GazeController::Command GazeController::step(const Encoders& encoders, bool measured) {
+    if (mode == EyeControlMode::Velocity) return stepVelocity(encoders, measured);
+    Command command{};
+    
+    if (measured) {
+        // update eye positions
+        eyeYawPosition = encoders.eyeYaw + degX;
+        eyeTiltPosition = encoders.eyeTilt - degY;  // negative because image y is inverted
+        command.moveEyes = true;
+    }
+    command.eyeYaw = eyeYawPosition;
+    command.eyeTilt = eyeTiltPosition;
+    command.moveVergence = vergencePending;
+    command.eyeVergence = vergencePosition;
+    vergencePending = false;
+    
+    // head compensation when eyes are not centered
+    if (std::abs(encoders.eyeYaw) > CENTERED || std::abs(encoders.eyeTilt) > CENTERED) {
+        command.neckPitchVelocity = eyeTiltPosition * gains.headGain;
+        command.neckYawVelocity = -eyeYawPosition * gains.headGain;
+    } else {
+        command.neckPitchVelocity = 0.0;
+        command.neckYawVelocity = 0.0;
+        
+        // reset integral terms when centered to prevent drift
+        integralX = 0.0;
+        integralY = 0.0;
+    }
+    
+    return command;
+}
+
+GazeController::Command GazeController::stepVelocity(const Encoders& encoders, bool measured) {
+    Command command{};
+    
+    // the pid output moves the gaze; kept relative to the body, it stays
+    // put while the neck turns under it
+    if (measured) {
+        gazeYawTarget = encoders.eyeYaw - encoders.neckYaw + degX;
+        gazeTiltTarget = encoders.eyeTilt + encoders.neckPitch - degY;  // image y is inverted
+    }
+    
+    // eye angles that hold the gaze with the neck where it is now, reached
+    // through a first-order loop; the neck velocity turns the eyes against
+    // the neck before the position error builds up
+    eyeYawPosition = gazeYawTarget + encoders.neckYaw;
+    eyeTiltPosition = gazeTiltTarget - encoders.neckPitch;
+    command.moveEyeVelocity = true;
+    command.eyeYawVelocity = clampVelocity(EYE_LOOP_GAIN * (eyeYawPosition - encoders.eyeYaw) +
+                                           encoders.neckYawVelocity);
+    command.eyeTiltVelocity = clampVelocity(EYE_LOOP_GAIN * (eyeTiltPosition - encoders.eyeTilt) -
+                                            encoders.neckPitchVelocity);
+    command.eyeYaw = eyeYawPosition;
+    command.eyeTilt = eyeTiltPosition;
+    command.moveVergence = vergencePending;
+    command.eyeVergence = vergencePosition;
+    vergencePending = false;
+    
+    // the neck takes over the eye offset as in position mode
+    if (std::abs(encoders.eyeYaw) > CENTERED || std::abs(encoders.eyeTilt) > CENTERED) {
+        command.neckPitchVelocity = eyeTiltPosition * gains.headGain;
+        command.neckYawVelocity = -eyeYawPosition * gains.headGain;
+    } else {
+        integralX = 0.0;
+        integralY = 0.0;
+    }
+    
+    return command;
+}
+
+bool GazeController::isConverged(const Encoders& encoders, double scale) const {
+    return std::abs(errX) < ERROR_THRESHOLD * scale &&
+           std::abs(errY) < ERROR_THRESHOLD * scale &&
+           std::abs(encoders.eyeTilt) < POSITION_THRESHOLD * scale &&
+           std::abs(encoders.eyeYaw) < POSITION_THRESHOLD * scale;
+}
@@ -1,45 +1,275 @@
 #include "GazeThread.h"
 #include <yarp/os/LogStream.h>
+#include <algorithm>
 #include <cmath>
+#include <future>
 
-GazeThread::GazeThread(double period) : 
+GazeThread::GazeThread(double period, WorkerPool* sharedWorkers) : 
     PeriodicThread(period),
-    isMovementDone(false),
-    eyeTiltPosition(0.0),
-    eyeYawPosition(0.0),
-    eyeEncoderTiltPosition(0.0),
-    eyeEncoderYawPosition(0.0),
-    neckPitchPosition(0.0),
-    neckYawPosition(0.0),
-    errX(0),
-    errY(0),
-    lastErrX(0),
-    lastErrY(0),
-    integralX(0.0),
-    integralY(0.0) {
+    name("/gazeControl"),
+    robot("/icubSim"),
+    ipc(nullptr),
+    ivc(nullptr),
+    icm(nullptr),
+    enc(nullptr),
+    head{0.0, 0.0, 0.0, 0.0, 0.0, 0.0},
+    hasTarget(false),
+    settleHysteresis(1.0),
+    lastCapture(-1.0),
+    converged(false),
+    holding(false),
+    lead(period),
+    targetErrorX(0.0),
+    targetErrorY(0.0),
+    imageWidth(0),
+    startTime(0.0),
+    trackingReported(false),
+    tick(0),
+    stats(period),
+    pool(sharedWorkers),
+    selectedBlob(-1),
+    stereoTarget{0.0, 0.0, 0.0, 0.0, 0.0},
+    hasStereoTarget(false) {
 }
 
 GazeThread::~GazeThread() {
     threadRelease();
 }
 
-bool GazeThread::configure() {
-    // open image input port
-    if (!imagePort.open("/gazeControl/img:i")) {
-        yError() << "failed to open image port";
+bool GazeThread::readSchedules(Searchable& config, ThreadSchedule& control, ThreadSchedule& capture,
+                               std::string& error) {
+    const std::string policyText = config.check("sched", Value("other"), "other, fifo or rr").asString();
+    if (!parseSchedulePolicy(policyText, control.policy)) {
+        error = "unknown scheduling policy " + policyText;
         return false;
     }
-    yarp.connect("/icubSim/cam/left", "/gazeControl/img:i");
+    control.priority = config.check("priority", Value(80), "control thread priority, 1 to 99").asInt32();
+    capture = control;
+    capture.priority = config.check("capture_priority", Value(control.priority - 1),
+                                    "camera port thread priority").asInt32();
+    return (!config.check("cpus") || parseCpuList(config.find("cpus").asString(), control.cpus, error)) &&
+           (!config.check("capture_cpus") || parseCpuList(config.find("capture_cpus").asString(), capture.cpus, error));
+}
+
+bool GazeThread::configure(Searchable& config) {
+    StartupProfile profile;
+    startTime = Time::now();
+    bool roiTracking = config.check("roi", Value(1), "scan only a window around the last target").asBool();
     
-    // configure robot head
+    // port prefixes of this controller and of the robot or simulator it drives
+    name = config.check("name", Value("/gazeControl"), "prefix of the controller's ports").asString();
+    robot = config.check("robot", Value("/icubSim"), "prefix of the robot's ports").asString();
+    
+    // real-time scheduling for the control thread, its workers and the
+    // camera port threads; the default scheduler unless asked
+    ThreadSchedule captureSchedule;
+    std::string error;
+    if (!readSchedules(config, controlSchedule, captureSchedule, error)) {
+        yError() << error;
+        return false;
+    }
+    grabber.setSchedule(captureSchedule);
+    rightGrabber.setSchedule(captureSchedule);
+    if (!controlSchedule.isDefault() || !captureSchedule.isDefault()) {
+        yInfo() << "control thread" << controlSchedule.describe() << ", camera threads" << captureSchedule.describe();
+    }
+    
+    // persistent segmentation workers, 0 means one per hardware thread;
+    // they share the control thread's scheduling, which waits on them. a
+    // host running several controllers passes one pool for all of them
+    auto workerStart = [this] {
+        std::string workerError;
+        if (!controlSchedule.isDefault() && !applyThreadSchedule(controlSchedule, workerError)) {
+            yError() << "segmentation worker:" << workerError;
+        }
+    };
+    if (!pool) {
+        int lanes = config.check("workers", Value(1), "segmentation threads").asInt32();
+        workers.reset(new WorkerPool(static_cast<size_t>(std::max(0, lanes)), workerStart));
+        pool = workers.get();
+    }
+    
+    // which red blob to follow when there are several
+    TargetPolicy policy = TargetPolicy::Largest;
+    const std::string policyName = config.check("target", Value("largest"),
+                                                "largest, nearest, tracked or centroid").asString();
+    if (!parseTargetPolicy(policyName, policy)) {
+        yError() << "unknown target policy" << policyName;
+        return false;
+    }
+    detector.reset(new TargetDetector(*pool, roiTracking, policy));
+    
+    // frames unchanged where they would be searched keep the last result,
+    // which frees the cpu while the gaze holds on a still target
+    const bool incremental = config.check("incremental", Value(0), "skip segmentation of unchanged frames").asBool();
+    const int changeThreshold = config.check("change_threshold", Value(FrameChangeDetector::THRESHOLD),
+                                             "colour change a pixel may have and still count as unchanged").asInt32();
+    detector->setIncremental(incremental, changeThreshold);
+    
+    // target colour rules, the built-in red test without a file
+    if (config.check("classifier")) {
+        ColorClassifier classifier;
+        if (!classifier.load(config.find("classifier").asString(), error)) {
+            yError() << "failed to load colour classifier:" << error;
+            return false;
+        }
+        detector->setClassifier(classifier);
+    }
+    yInfo() << "colour classifier:" << detector->getClassifier().describe();
+    yInfo() << "segmentation kernel" << segmentKernelName(activeSegmentKernel())
+            << "on" << pool->size() << (workers ? "threads" : "shared threads") << ", target" << targetPolicyName(policy);
+    
+    // settling trials: how long the gaze must hold, how far it may drift
+    // while holding and when a trial gives up
+    ConvergenceMonitor::Options settle;
+    settle.dwell = config.check("dwell", Value(0.0), "seconds converged before a trial settles").asFloat64();
+    settle.hysteresis = config.check("hysteresis", Value(1.5), "exit thresholds over entry thresholds").asFloat64();
+    settle.timeout = config.check("settle_timeout", Value(10.0), "seconds before a trial times out").asFloat64();
+    convergence.setOptions(settle);
+    settleHysteresis = std::max(1.0, settle.hysteresis);
+    
+    // pid and head gains: the defaults, then a gains file, then single gains
+    // from the command line, so a tuned file can be loaded without a rebuild
+    GazeGains gains;
+    if (config.check("gains") && !gains.load(config.find("gains").asString(), error)) {
+        yError() << "failed to load gains:" << error;
+        return false;
+    }
+    gains.kp = config.check("kp", Value(gains.kp), "proportional gain").asFloat64();
+    gains.ki = config.check("ki", Value(gains.ki), "integral gain").asFloat64();
+    gains.kd = config.check("kd", Value(gains.kd), "derivative gain").asFloat64();
+    gains.headGain = config.check("head_gain", Value(gains.headGain), "neck velocity per degree of eye offset").asFloat64();
+    gains.maxIntegral = config.check("max_integral", Value(gains.maxIntegral), "anti-windup limit").asFloat64();
+    if (!gains.isValid()) {
+        yError() << "gains must be finite and not negative";
+        return false;
+    }
+    controller.setGains(gains);
+    yInfo() << "gains:" << gains.describe();
+    
+    // eyes on position targets per frame, or on velocities from a joint loop
+    // that compensates the neck between frames
+    const std::string eyeModeName = config.check("eyes", Value("position"), "position or velocity").asString();
+    EyeControlMode eyeMode = EyeControlMode::Position;
+    if (!parseEyeControlMode(eyeModeName, eyeMode)) {
+        yError() << "unknown eye control mode" << eyeModeName;
+        return false;
+    }
+    controller.setMode(eyeMode);
+    
+    // velocity eyes: this loop becomes the joint loop and runs faster than
+    // the camera; the pid still only moves the gaze target on a new frame
+    if (eyeMode == EyeControlMode::Velocity) {
+        const double innerPeriod = config.check("inner_period", Value(0.005),
+                                                "joint loop period with velocity eyes, seconds").asFloat64();
+        if (innerPeriod <= 0.0 || !setPeriod(innerPeriod)) {
+            yError() << "invalid joint loop period" << innerPeriod;
+            return false;
+        }
+        stats.setPeriod(innerPeriod);
+        yInfo() << "velocity eyes, joint loop every" << innerPeriod << "s";
+    }
+    
+    // kalman prediction of the target direction over camera and actuation
+    // latency, by default one tick of the loop as it finally runs
+    const double fov = config.check("fov", Value(63.8), "horizontal camera field of view, degrees").asFloat64();
+    if (config.check("predict", Value(1), "run the pid on the predicted target error").asBool()) {
+        predictor.reset(new TargetPredictor(fov));
+        lead = config.check("lead", Value(getPeriod()), "prediction horizon past the current tick, seconds").asFloat64();
+    }
+    
+    // bounded waits for the simulator or robot, instead of fixed delays
+    const double startupTimeout = config.check("startup_timeout", Value(10.0),
+                                               "seconds to wait for the head and cameras").asFloat64();
+    const double homeTimeout = config.check("home_timeout", Value(3.0), "seconds to wait for homing").asFloat64();
+    profile.mark("setup");
+    
+    // the control board connects on a thread of its own while the ports
+    // below are opened; the future waits for it on any early return
     prop.put("device", "remote_controlboard");
-    prop.put("local", "/gazeControl");
-    prop.put("remote", "/icubSim/head");
+    prop.put("local", name);
+    prop.put("remote", robot + "/head");
+    double headSeconds = 0.0;
+    std::future<bool> headOpened = std::async(std::launch::async, [this, startupTimeout, &headSeconds] {
+        StartupProfile headProfile;
+        const std::string headPort = robot + "/head/rpc:i";
+        const bool ok = waitUntil([&headPort] { return Network::exists(headPort); }, startupTimeout, STARTUP_POLL) &&
+                        robotHead.open(prop);
+        headSeconds = headProfile.elapsed();
+        return ok;
+    });
+    
+    // open image input port, frames land in the grabber's latest-frame slot
+    if (!grabber.open(name + "/img:i")) {
+        yError() << "failed to open image port";
+        return false;
+    }
+    
+    // stereo: a second camera, its own detector and pool so both eyes are
+    // searched at the same time, and vergence from the triangulated target
+    const bool stereoMode = config.check("stereo", Value(0), "fuse both cameras and control vergence").asBool();
+    if (stereoMode) {
+        if (workers) rightWorkers.reset(new WorkerPool(workers->size(), workerStart));
+        rightDetector.reset(new TargetDetector(rightWorkers ? *rightWorkers : *pool, roiTracking, policy));
+        rightDetector->setClassifier(detector->getClassifier());
+        rightDetector->setIncremental(incremental, changeThreshold);
+        stereo.reset(new StereoDetector(*detector, *rightDetector, workerStart));
+        geometry = StereoGeometry(fov);
+        
+        if (!rightGrabber.open(name + "/right:i")) {
+            yError() << "failed to open right image port";
+            return false;
+        }
+        yInfo() << "stereo mode, frames paired within" << StereoPairer::MAX_SKEW << "s";
+    }
+    
+    // session log of every camera frame and control tick, written off this thread
+    if (config.check("record")) {
+        const std::string path = config.find("record").asString();
+        recorder.reset(new SessionRecorder(telemetry));
+        if (!recorder->open(path)) {
+            yError() << "failed to open session log" << path;
+            return false;
+        }
+        grabber.setRecorder(recorder.get());
+        yInfo() << "recording session to" << path;
+    }
     
-    if (!robotHead.open(prop)) {
+    // the same records for plotters in other processes, batched off this thread
+    if (config.check("telemetry", Value(1), "publish telemetry on <name>/telemetry:o").asBool()) {
+        publisher.reset(new TelemetryPublisher(telemetry));
+        if (!publisher->open(name + "/telemetry:o")) {
+            yError() << "failed to open telemetry port";
+            return false;
+        }
+    }
+    
+    // latency statistics on demand: stats, report, reset
+    rpcPort.setReader(*this);
+    if (!rpcPort.open(name + "/rpc")) {
+        yError() << "failed to open rpc port";
+        return false;
+    }
+    profile.mark("ports");
+    
+    // cameras connected as soon as they exist; the loop runs without
+    // frames if they never show up, a later manual connect still works
+    auto camerasConnected = [this, stereoMode] {
+        return Network::connect(robot + "/cam/left", name + "/img:i") &&
+               (!stereoMode || Network::connect(robot + "/cam/right", name + "/right:i"));
+    };
+    if (!waitUntil(camerasConnected, startupTimeout, STARTUP_POLL)) {
+        yWarning() << "camera not connected after" << startupTimeout << "s";
+    }
+    profile.mark("cameras");
+    
+    // configure robot head
+    if (!headOpened.get()) {
         yError() << "failed to connect to robot head";
         return false;
     }
+    profile.add("head (concurrent)", headSeconds);
+    profile.mark("head wait");
     
     // get interfaces
     bool ok = robotHead.view(ipc) &&
@@ -53,125 +283,375 @@ bool GazeThread::configure() {
         return false;
     }
     
+    // one buffer for every head joint, filled by a single getEncoders call
+    int axes = 0;
+    if (!enc->getAxes(&axes) || axes <= (stereo ? EYE_VERGENCE : EYE_YAW)) {
+        yError() << "unexpected number of head joints" << axes;
+        robotHead.close();
+        return false;
+    }
+    encoders.assign(axes, 0.0);
+    if (controller.getMode() == EyeControlMode::Velocity) speeds.assign(axes, 0.0);
+    
     // initialize control modes
-    icm->setControlMode(0, VOCAB_CM_POSITION);  // neck pitch
-    icm->setControlMode(2, VOCAB_CM_POSITION);  // neck yaw
-    icm->setControlMode(3, VOCAB_CM_POSITION);  // eyes tilt
-    icm->setControlMode(4, VOCAB_CM_POSITION);  // eyes pan
+    int positionModes[] = {VOCAB_CM_POSITION, VOCAB_CM_POSITION};
+    icm->setControlModes(2, NECK_JOINTS, positionModes);
+    icm->setControlModes(2, EYE_JOINTS, positionModes);
     
     // move to initial position
-    ipc->positionMove(0, 0.0);
-    ipc->positionMove(2, 0.0);
-    ipc->positionMove(3, 0.0);
-    ipc->positionMove(4, 0.0);
+    const double home[] = {0.0, 0.0};
+    ipc->positionMove(2, NECK_JOINTS, home);
+    ipc->positionMove(2, EYE_JOINTS, home);
+    if (stereo) {
+        icm->setControlMode(EYE_VERGENCE, VOCAB_CM_POSITION);
+        ipc->positionMove(EYE_VERGENCE, 0.0);
+    }
     
-    yarp::os::Time::delay(2.0);  // wait for initial positioning
+    // on to velocity control as soon as the joints report arrival, rather
+    // than after a fixed delay; already home is done at once
+    auto homed = [this] {
+        bool neckDone = false, eyesDone = false, vergenceDone = true;
+        ipc->checkMotionDone(2, NECK_JOINTS, &neckDone);
+        ipc->checkMotionDone(2, EYE_JOINTS, &eyesDone);
+        if (stereo) ipc->checkMotionDone(EYE_VERGENCE, &vergenceDone);
+        return neckDone && eyesDone && vergenceDone;
+    };
+    if (!waitUntil(homed, homeTimeout, STARTUP_POLL)) {
+        yWarning() << "head not home after" << homeTimeout << "s, starting anyway";
+    }
+    profile.mark("homing");
     
-    // switch neck to velocity control
-    icm->setControlMode(0, VOCAB_CM_VELOCITY);
-    icm->setControlMode(2, VOCAB_CM_VELOCITY);
-    ivc->velocityMove(0, 0.0);
-    ivc->velocityMove(2, 0.0);
+    // switch neck to velocity control, and the eyes in velocity mode
+    int velocityModes[] = {VOCAB_CM_VELOCITY, VOCAB_CM_VELOCITY};
+    icm->setControlModes(2, NECK_JOINTS, velocityModes);
+    ivc->velocityMove(2, NECK_JOINTS, home);
+    if (controller.getMode() == EyeControlMode::Velocity) {
+        icm->setControlModes(2, EYE_JOINTS, velocityModes);
+        ivc->velocityMove(2, EYE_JOINTS, home);
+    }
     
+    // everything allocated so far is faulted in and stays in ram
+    if (config.check("mlock", Value(0), "lock the process memory").asBool()) {
+        if (!lockProcessMemory(error)) {
+            yError() << error;
+            return false;
+        }
+        yInfo() << "process memory locked";
+    }
+    
+    yInfo() << "startup:" << profile.describe();
+    return true;
+}
+
+bool GazeThread::threadInit() {
+    std::string error;
+    if (!controlSchedule.isDefault() && !applyThreadSchedule(controlSchedule, error)) {
+        yError() << "control thread:" << error;
+        return false;
+    }
+    prefaultStack();
     return true;
 }
 
 void GazeThread::run() {
-    // get image
-    ImageOf<PixelRgb>* image = imagePort.read();
-    if (!image) return;
-    
-    // find red pixels
-    int pixelMeanX = 0, pixelMeanY = 0;
-    int numRedPixels = 0;
-    
-    for (size_t x = 0; x < image->width(); x++) {
-        for (size_t y = 0; y < image->height(); y++) {
-            const PixelRgb& pixel = image->pixel(x, y);
-            if (pixel.r > 2*pixel.g && pixel.r > 2*pixel.b) {
-                pixelMeanX += x;
-                pixelMeanY += y;
-                numRedPixels++;
-            }
-        }
+    stats.recordStart();
+    stageTimer.start();
+    sample = TelemetrySample();
+    converged = holding = false;
+    
+    controlTick();
+    sample.tickTime = stageTimer.total();
+    stats.record(sample);
+    
+    // wakes a settle waiter on this very tick; also times trials out while
+    // no target is seen
+    convergence.update(Time::now(), lastCapture, converged, holding);
+    
+    // one record per tick, whichever way the tick ended
+    publishTelemetry();
+}
+
+void GazeThread::controlTick() {
+    // vision update on a new frame, predict-only tick otherwise
+    // the handle keeps the frame's slab out of the pool until the tick ends
+    FrameRef frame = grabber.latest();
+    FrameRef rightFrame;
+    if (stereo) {
+        // only a left/right pair counts as a new frame
+        pairer.pushLeft(std::move(frame));
+        pairer.pushRight(rightGrabber.latest());
+        pairer.pair(frame, rightFrame);
     }
+    sample.stageTime[STAGE_FRAME] = stageTimer.lap();
     
-    if (numRedPixels < 50) return;  // not enough red pixels found
+    const bool measured = frame && updateVision(frame, rightFrame);
+    sample.measured = measured ? 1 : 0;
+    if (measured) lastCapture = frame.timestamp();
     
-    // calculate centroid
-    pixelMeanX /= numRedPixels;
-    pixelMeanY /= numRedPixels;
+    // a missed detection ends tracking, with prediction only once the filter
+    // stops coasting; the eyes then hold where they are and the neck stops
+    if (hasTarget && !measured && (predictor ? !predictor->isTracking(Time::now()) : static_cast<bool>(frame))) {
+        hasTarget = false;
+        stopHead();
+    }
+    if (!measured && !hasTarget) return;  // nothing to track
     
-    // calculate error from center
-    errX = pixelMeanX - (image->width() / 2);
-    errY = pixelMeanY - (image->height() / 2);
+    // get current head positions in one request, and the neck velocity fed
+    // forward to velocity eyes
+    const bool encodersRead = enc->getEncoders(encoders.data()) &&
+                              (speeds.empty() || enc->getEncoderSpeeds(speeds.data()));
+    const double now = Time::now();
+    sample.stageTime[STAGE_ENCODERS] = stageTimer.lap();
+    if (!encodersRead) return;
+    head.eyeYaw = encoders[EYE_YAW];
+    head.eyeTilt = encoders[EYE_TILT];
+    head.neckPitch = encoders[NECK_PITCH];
+    head.neckYaw = encoders[NECK_YAW];
+    if (!speeds.empty()) {
+        head.neckPitchVelocity = speeds[NECK_PITCH];
+        head.neckYawVelocity = speeds[NECK_YAW];
+    }
+    if (measured && stereo) updateVergence();
     
-    // update integral terms with anti-windup
-    integralX += errX;
-    integralY += errY;
+    // new eye targets on a detection, or on every tick while the predictor
+    // tracks; velocity eyes keep their gaze target between frames
+    bool active = measured;
+    if (predictor) {
+        predictor->recordHead(now, head);
+        if (measured) {
+            predictor->measure(frame.timestamp(), targetErrorX, targetErrorY, imageWidth);
+        }
+        
+        double errorX, errorY;
+        active = (measured || controller.getMode() == EyeControlMode::Position) &&
+                 predictor->predictError(now + lead, head, errorX, errorY);
+        if (active) {
+            controller.updateError(static_cast<int>(std::lround(errorX)),
+                                   static_cast<int>(std::lround(errorY)));
+        }
+    }
     
-    // apply anti-windup by clamping integral terms
-    integralX = std::max(-MAX_INTEGRAL, std::min(MAX_INTEGRAL, integralX));
-    integralY = std::max(-MAX_INTEGRAL, std::min(MAX_INTEGRAL, integralY));
+    const GazeController::Command command = controller.step(head, active);
     
-    // pid control
-    double degX = errX * Kp +                    // proportional
-                 integralX * Ki +                // integral
-                 (lastErrX - errX) * Kd;         // derivative
-                 
-    double degY = errY * Kp +                    // proportional
-                 integralY * Ki +                // integral
-                 (lastErrY - errY) * Kd;         // derivative
+    // move both eye joints with one command
+    if (command.moveEyes) {
+        const double eyeTargets[] = {command.eyeYaw, command.eyeTilt};
+        ipc->positionMove(2, EYE_JOINTS, eyeTargets);
+    }
+    if (command.moveEyeVelocity) {
+        const double eyeVelocities[] = {command.eyeYawVelocity, command.eyeTiltVelocity};
+        ivc->velocityMove(2, EYE_JOINTS, eyeVelocities);
+    }
+    if (command.moveVergence) {
+        ipc->positionMove(EYE_VERGENCE, command.eyeVergence);
+    }
     
-    // get current eye positions
-    enc->getEncoder(4, &eyeEncoderYawPosition);   // eye yaw
-    enc->getEncoder(3, &eyeEncoderTiltPosition);  // eye tilt
-    enc->getEncoder(0, &neckPitchPosition);       // neck pitch
-    enc->getEncoder(2, &neckYawPosition);         // neck yaw
+    // head compensation, zero while the eyes are centred
+    const double neckVelocities[] = {command.neckPitchVelocity, command.neckYawVelocity};
+    ivc->velocityMove(2, NECK_JOINTS, neckVelocities);
+    sample.stageTime[STAGE_COMMAND] = stageTimer.lap();
     
-    // update eye positions
-    eyeYawPosition = eyeEncoderYawPosition + degX;
-    eyeTiltPosition = eyeEncoderTiltPosition - degY;  // negative because image y is inverted
+    // camera-to-actuation latency, when the camera stamps its frames
+    if (measured && frame.hasStamp()) {
+        sample.cameraLatency = static_cast<float>(Time::now() - frame.timestamp());
+    }
     
-    // move eyes
-    ipc->positionMove(4, eyeYawPosition);
-    ipc->positionMove(3, eyeTiltPosition);
+    // settled against the plain thresholds, still holding against the looser ones
+    converged = controller.isConverged(head);
+    holding = controller.isConverged(head, settleHysteresis);
+}
+
+void GazeThread::stopHead() {
+    const double stop[] = {0.0, 0.0};
+    ivc->velocityMove(2, NECK_JOINTS, stop);
+    if (controller.getMode() == EyeControlMode::Velocity) ivc->velocityMove(2, EYE_JOINTS, stop);
+}
+
+bool GazeThread::updateVision(const FrameRef& frame, const FrameRef& rightFrame) {
+    // find red pixels, in both eyes at once for a stereo pair
+    SegmentMoments moments;
+    bool found;
+    if (rightFrame) {
+        stereoDetection = stereo->detect(frame, rightFrame);
+        found = stereoDetection.left || stereoDetection.right;
+    } else {
+        found = detector->detect(frame.data(), frame.rowStride(),
+                                 frame.width(), frame.height(), moments);
+    }
+    sample.stageTime[STAGE_SEGMENT] = stageTimer.lap();
     
-    // head compensation when eyes are not centered
-    if (std::abs(eyeEncoderYawPosition) > 0.1 || std::abs(eyeEncoderTiltPosition) > 0.1) {
-        double neckPitchVel = eyeTiltPosition * HEAD_GAIN;
-        double neckYawVel = -eyeYawPosition * HEAD_GAIN;
-        
-        ivc->velocityMove(0, neckPitchVel);    // neck pitch
-        ivc->velocityMove(2, neckYawVel);      // neck yaw
+    // blob list for the rpc port, the lock is never contended by the control loop
+    {
+        std::lock_guard<std::mutex> lock(blobMutex);
+        blobs.assign(detector->getBlobs().begin(), detector->getBlobs().end());
+        selectedBlob = detector->getSelected();
+    }
+    
+    if (!found) return false;  // not enough red pixels found
+    
+    if (rightFrame) {
+        stereoDetection.cyclopean(targetErrorX, targetErrorY);
+        sample.pixelCount = static_cast<uint32_t>(stereoDetection.left ? stereoDetection.leftPixels
+                                                                        : stereoDetection.rightPixels);
     } else {
-        ivc->velocityMove(0, 0.0);
-        ivc->velocityMove(2, 0.0);
+        sample.pixelCount = static_cast<uint32_t>(moments.count);
         
-        // reset integral terms when centered to prevent drift
-        integralX = 0.0;
-        integralY = 0.0;
+        // calculate centroid
+        int pixelMeanX = static_cast<int>(moments.sumX / moments.count);
+        int pixelMeanY = static_cast<int>(moments.sumY / moments.count);
+        
+        // error from center; the pid runs on it now or after prediction
+        targetErrorX = pixelMeanX - static_cast<int>(frame.width() / 2);
+        targetErrorY = pixelMeanY - static_cast<int>(frame.height() / 2);
+    }
+    imageWidth = frame.width();
+    if (!predictor) {
+        controller.updateError(static_cast<int>(std::lround(targetErrorX)),
+                               static_cast<int>(std::lround(targetErrorY)));
     }
     
-    // store errors for derivative control
-    lastErrX = errX;
-    lastErrY = errY;
+    hasTarget = true;
+    if (!trackingReported) {
+        yInfo() << "tracking" << Time::now() - startTime << "s after startup";
+        trackingReported = true;
+    }
+    sample.stageTime[STAGE_CONTROL] = stageTimer.lap();
+    return true;
+}
+
+void GazeThread::updateVergence() {
+    // the eyes are read after the frame was taken; vergence moves slowly
+    // enough that the difference is below the triangulation noise
+    StereoTarget target;
+    if (!geometry.triangulate(stereoDetection, imageWidth, encoders[EYE_YAW],
+                              encoders[EYE_VERGENCE], encoders[EYE_TILT], target)) {
+        return;
+    }
+    controller.updateVergence(target.vergence);
+    
+    std::lock_guard<std::mutex> lock(blobMutex);
+    stereoTarget = target;
+    hasStereoTarget = true;
+}
+
+void GazeThread::publishTelemetry() {
+    sample.timestamp = Time::now();
+    sample.tick = tick++;
+    sample.errorX = controller.getErrorX();
+    sample.errorY = controller.getErrorY();
+    sample.eyeYawCommand = controller.getEyeYawTarget();
+    sample.eyeTiltCommand = controller.getEyeTiltTarget();
+    sample.eyeYaw = head.eyeYaw;
+    sample.eyeTilt = head.eyeTilt;
+    sample.neckPitch = head.neckPitch;
+    sample.neckYaw = head.neckYaw;
+    telemetry.publish(sample);
+}
+
+bool GazeThread::read(ConnectionReader& connection) {
+    Bottle command, reply;
+    if (!command.read(connection)) return false;
+    
+    const std::string verb = command.get(0).asString();
+    if (verb == "stats") {
+        // (name count p50 p99 p99.9 max) per stage, times in ms
+        for (const LoopStatistics::Summary& row : stats.summaries()) {
+            Bottle& entry = reply.addList();
+            entry.addString(row.name);
+            entry.addInt64(static_cast<int64_t>(row.count));
+            entry.addFloat64(row.p50 * 1e3);
+            entry.addFloat64(row.p99 * 1e3);
+            entry.addFloat64(row.p999 * 1e3);
+            entry.addFloat64(row.max * 1e3);
+        }
+        Bottle& overruns = reply.addList();
+        overruns.addString("overruns");
+        overruns.addInt64(static_cast<int64_t>(stats.getOverruns()));
+    } else if (verb == "report") {
+        reply.addString(stats.report());
+    } else if (verb == "reset") {
+        stats.reset();
+        reply.addString("ok");
+    } else if (verb == "blobs") {
+        // (id area x y width height selected) per blob of the last frame
+        std::lock_guard<std::mutex> lock(blobMutex);
+        for (size_t i = 0; i < blobs.size(); i++) {
+            Bottle& entry = reply.addList();
+            entry.addInt32(static_cast<int32_t>(blobs[i].id));
+            entry.addInt64(static_cast<int64_t>(blobs[i].area()));
+            entry.addFloat64(blobs[i].centerX());
+            entry.addFloat64(blobs[i].centerY());
+            entry.addInt32(static_cast<int32_t>(blobs[i].box.width()));
+            entry.addInt32(static_cast<int32_t>(blobs[i].box.height()));
+            entry.addInt32(static_cast<int>(i) == selectedBlob ? 1 : 0);
+        }
+    } else if (verb == "track" && command.size() > 1) {
+        detector->getSelector().track(static_cast<uint32_t>(command.get(1).asInt32()));
+        reply.addString(detector->getPolicy() == TargetPolicy::Tracked ? "ok" : "ok, effective with --target tracked");
+    } else if (verb == "target") {
+        // (x y z distance vergence) of the last stereo fix, metres and degrees
+        std::lock_guard<std::mutex> lock(blobMutex);
+        if (hasStereoTarget) {
+            reply.addFloat64(stereoTarget.x);
+            reply.addFloat64(stereoTarget.y);
+            reply.addFloat64(stereoTarget.z);
+            reply.addFloat64(stereoTarget.distance);
+            reply.addFloat64(stereoTarget.vergence);
+        } else {
+            reply.addString(stereo ? "no stereo fix yet" : "target position needs --stereo 1");
+        }
+    } else {
+        reply.addString("unknown command, expected stats, report, reset, blobs, track <id> or target");
+    }
     
-    // check if movement is complete
-    isMovementDone = (std::abs(errX) < ERROR_THRESHOLD &&
-                     std::abs(errY) < ERROR_THRESHOLD &&
-                     std::abs(eyeEncoderTiltPosition) < POSITION_THRESHOLD &&
-                     std::abs(eyeEncoderYawPosition) < POSITION_THRESHOLD);
+    ConnectionWriter* writer = connection.getWriter();
+    if (writer) {
+        reply.write(*writer);
+    }
+    return true;
 }
 
 void GazeThread::threadRelease() {
-    // stop all movements
-    if (ivc) {
-        ivc->velocityMove(0, 0.0);
-        ivc->velocityMove(2, 0.0);
+    // nobody waits on a loop that has stopped
+    convergence.cancel();
+    
+    // report loop timing once, before the devices go away
+    if (enc && stats.getTicks() > 0) {
+        yInfo() << "control loop latency\n" << stats.report();
+        if (detector && detector->isIncremental()) {
+            yInfo() << "detection skipped on" << static_cast<int64_t>(detector->getReusedFrames()) << "of"
+                    << static_cast<int64_t>(detector->getFrames()) << "frames";
+        }
     }
     
-    // close devices and ports
+    // stop all movements
+    if (ivc) stopHead();
+    
+    // close devices and ports, the interfaces die with the driver
     robotHead.close();
-    imagePort.close();
+    ipc = nullptr;
+    ivc = nullptr;
+    icm = nullptr;
+    enc = nullptr;
+    grabber.close();
+    rightGrabber.close();
+    pairer.reset();
+    
+    // flush the recording once no more frames can arrive
+    if (recorder) {
+        grabber.setRecorder(nullptr);
+        recorder->close();
+        yInfo() << "session log" << static_cast<double>(recorder->bytesWritten()) / (1 << 20) << "MB,"
+                << recorder->getDroppedFrames() << "frames dropped,"
+                << static_cast<int64_t>(recorder->getLostSamples()) << "ticks lost";
+        recorder.reset();
+    }
+    if (publisher) {
+        publisher->close();
+        yInfo() << "telemetry export" << static_cast<int64_t>(publisher->getBatches()) << "batches,"
+                << static_cast<int64_t>(publisher->getLostSamples()) << "ticks lost";
+        publisher.reset();
+    }
+    rpcPort.interrupt();
+    rpcPort.close();
 }
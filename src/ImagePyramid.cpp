@@ -0,0 +1,96 @@
+#include "ImagePyramid.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GAZE_PYRAMID_X86 1
+#else
+#define GAZE_PYRAMID_X86 0
+#endif
+
+namespace {
+
+using RowReducer = void (*)(const unsigned char* a, const unsigned char* b, size_t outWidth,
+                            unsigned char* out);
+
+// one output row from two input rows: each output pixel is the rounded mean
+// of a 2x2 block, vertical pair first
+void reduceRowScalar(const unsigned char* a, const unsigned char* b, size_t outWidth,
+                     unsigned char* out) {
+    for (size_t x = 0; x < outWidth; x++, a += 6, b += 6, out += 3) {
+        for (size_t c = 0; c < 3; c++) {
+            const int left = (a[c] + b[c] + 1) >> 1;
+            const int right = (a[c + 3] + b[c + 3] + 1) >> 1;
+            out[c] = static_cast<unsigned char>((left + right + 1) >> 1);
+        }
+    }
+}
+
+#if GAZE_PYRAMID_X86
+
+// loads at +0 and +3 line each pixel up with its right neighbour, so two
+// byte-wise averages give every 2x2 mean at once; the means that start an
+// output pixel sit in bytes 0-2, 6-8 and 12-14 and one shuffle packs them
+__attribute__((target("ssse3")))
+void reduceRowSSSE3(const unsigned char* a, const unsigned char* b, size_t outWidth,
+                    unsigned char* out) {
+    const __m128i pack = _mm_setr_epi8(0, 1, 2, 6, 7, 8, 12, 13, 14, -1, -1, -1, -1, -1, -1, -1);
+    
+    // the 16-byte store spills into the next three pixels, which the next
+    // step or the scalar tail overwrites
+    size_t x = 0;
+    for (; x + 6 <= outWidth; x += 3) {
+        const unsigned char* pa = a + 6 * x;
+        const unsigned char* pb = b + 6 * x;
+        const __m128i left = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pa)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(pb)));
+        const __m128i right = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pa + 3)),
+                                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(pb + 3)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 3 * x),
+                         _mm_shuffle_epi8(_mm_avg_epu8(left, right), pack));
+    }
+    reduceRowScalar(a + 6 * x, b + 6 * x, outWidth - x, out + 3 * x);
+}
+
+#endif
+
+RowReducer detectReducer() {
+#if GAZE_PYRAMID_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) return reduceRowSSSE3;
+#endif
+    return reduceRowScalar;
+}
+
+} // namespace
+
+void ImagePyramid::downsample(const unsigned char* src, size_t srcStride, size_t width, size_t height,
+                              unsigned char* dst, size_t dstStride) {
+    static const RowReducer reduceRow = detectReducer();
+    
+    const size_t outWidth = width / 2, outHeight = height / 2;
+    for (size_t y = 0; y < outHeight; y++) {
+        reduceRow(src + 2 * y * srcStride, src + (2 * y + 1) * srcStride, outWidth, dst + y * dstStride);
+    }
+}
+
+void ImagePyramid::build(const unsigned char* data, size_t rowStride, size_t width, size_t height,
+                         size_t maxLevels, size_t minWidth) {
+    maxLevels = std::max<size_t>(1, std::min(maxLevels, MAX_LEVELS));
+    pyramid[0] = Level{data, width, height, rowStride, 1};
+    count = 1;
+    
+    while (count < maxLevels) {
+        const Level& previous = pyramid[count - 1];
+        const size_t levelWidth = previous.width / 2, levelHeight = previous.height / 2;
+        if (levelWidth < minWidth || levelHeight == 0) break;
+        
+        std::vector<unsigned char>& buffer = buffers[count];
+        if (buffer.size() < levelWidth * levelHeight * 3) buffer.resize(levelWidth * levelHeight * 3);
+        downsample(previous.data, previous.rowStride, previous.width, previous.height,
+                   buffer.data(), levelWidth * 3);
+        
+        pyramid[count] = Level{buffer.data(), levelWidth, levelHeight, levelWidth * 3, previous.scale * 2};
+        count++;
+    }
+}
@@ -0,0 +1,72 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    for (std::atomic<uint64_t>& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+    sumMicros.store(0, std::memory_order_relaxed);
+    maxMicros.store(0, std::memory_order_relaxed);
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t micros) {
+    if (micros < 2 * SUB_COUNT) return static_cast<size_t>(micros);
+    
+    // exponent picks the band, the top SUB_BITS + 1 bits pick the slot in it
+    const int exponent = 63 - __builtin_clzll(micros);
+    const int shift = exponent - SUB_BITS;
+    const size_t bucket = static_cast<size_t>(shift) * SUB_COUNT + static_cast<size_t>(micros >> shift);
+    return std::min(bucket, BUCKETS - 1);
+}
+
+double LatencyHistogram::bucketMidpoint(size_t bucket) {
+    if (bucket < 2 * SUB_COUNT) return bucket * 1e-6;
+    
+    const int shift = static_cast<int>(bucket / SUB_COUNT) - 1;
+    const uint64_t mantissa = bucket % SUB_COUNT + SUB_COUNT;
+    const double lower = static_cast<double>(mantissa << shift);
+    const double width = static_cast<double>(uint64_t(1) << shift);
+    return (lower + width / 2.0) * 1e-6;
+}
+
+void LatencyHistogram::record(double seconds) {
+    const uint64_t micros = seconds > 0.0 ? static_cast<uint64_t>(std::llround(seconds * 1e6)) : 0;
+    
+    // single writer: plain load/store is enough for the running max
+    buckets[bucketOf(micros)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    sumMicros.fetch_add(micros, std::memory_order_relaxed);
+    if (micros > maxMicros.load(std::memory_order_relaxed)) {
+        maxMicros.store(micros, std::memory_order_relaxed);
+    }
+}
+
+double LatencyHistogram::max() const {
+    return maxMicros.load(std::memory_order_relaxed) * 1e-6;
+}
+
+double LatencyHistogram::mean() const {
+    const uint64_t n = count();
+    return n ? sumMicros.load(std::memory_order_relaxed) * 1e-6 / n : 0.0;
+}
+
+double LatencyHistogram::percentile(double q) const {
+    const uint64_t n = count();
+    if (n == 0) return 0.0;
+    
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * n)));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+        seen += buckets[bucket].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(bucketMidpoint(bucket), max());
+        }
+    }
+    return max();
+}
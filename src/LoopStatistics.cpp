@@ -0,0 +1,88 @@
+#include "LoopStatistics.h"
+#include <cmath>
+#include <cstdio>
+
+LoopStatistics::LoopStatistics(double period) :
+    period(period),
+    overruns(0),
+    started(false) {
+}
+
+void LoopStatistics::setPeriod(double seconds) {
+    period = seconds;
+    started = false;
+    reset();
+}
+
+void LoopStatistics::recordStart() {
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (started) {
+        const double interval = std::chrono::duration<double>(now - lastStart).count();
+        jitter.record(std::abs(interval - period));
+    }
+    lastStart = now;
+    started = true;
+}
+
+void LoopStatistics::record(const TelemetrySample& sample) {
+    // stages that did not run this tick are left out of their histogram
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        if (sample.stageTime[stage] > 0.0f) {
+            stages[stage].record(sample.stageTime[stage]);
+        }
+    }
+    
+    tick.record(sample.tickTime);
+    if (sample.tickTime > period) {
+        overruns.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    if (sample.cameraLatency > 0.0f) {
+        camera.record(sample.cameraLatency);
+    }
+}
+
+void LoopStatistics::reset() {
+    for (LatencyHistogram& stage : stages) stage.reset();
+    tick.reset();
+    camera.reset();
+    jitter.reset();
+    overruns.store(0, std::memory_order_relaxed);
+}
+
+std::vector<LoopStatistics::Summary> LoopStatistics::summaries() const {
+    auto summarize = [](const char* name, const LatencyHistogram& histogram) {
+        return Summary{name, histogram.count(),
+                       histogram.percentile(0.5), histogram.percentile(0.99),
+                       histogram.percentile(0.999), histogram.max()};
+    };
+    
+    std::vector<Summary> rows;
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        rows.push_back(summarize(telemetryStageName(stage), stages[stage]));
+    }
+    rows.push_back(summarize("tick", tick));
+    rows.push_back(summarize("camera", camera));
+    rows.push_back(summarize("jitter", jitter));
+    return rows;
+}
+
+std::string LoopStatistics::report() const {
+    char line[128];
+    std::string text;
+    
+    std::snprintf(line, sizeof(line), "%-10s %10s %9s %9s %9s %9s\n",
+                  "stage", "count", "p50 ms", "p99 ms", "p99.9 ms", "max ms");
+    text += line;
+    for (const Summary& row : summaries()) {
+        std::snprintf(line, sizeof(line), "%-10s %10llu %9.3f %9.3f %9.3f %9.3f\n",
+                      row.name.c_str(), static_cast<unsigned long long>(row.count),
+                      row.p50 * 1e3, row.p99 * 1e3, row.p999 * 1e3, row.max * 1e3);
+        text += line;
+    }
+    std::snprintf(line, sizeof(line), "overruns: %llu of %llu ticks (period %.1f ms)\n",
+                  static_cast<unsigned long long>(getOverruns()),
+                  static_cast<unsigned long long>(getTicks()), period * 1e3);
+    text += line;
+    return text;
+}
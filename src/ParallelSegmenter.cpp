@@ -0,0 +1,30 @@
+#include "ParallelSegmenter.h"
+#include <algorithm>
+
+ParallelSegmenter::ParallelSegmenter(WorkerPool& pool, size_t bandsPerLane) :
+    pool(pool),
+    classifier(nullptr),
+    partials(pool.size() * std::max<size_t>(1, bandsPerLane)) {
+}
+
+SegmentMoments ParallelSegmenter::segment(const unsigned char* data, size_t rowStride,
+                                          const Region& region) {
+    const size_t rows = region.height();
+    const size_t bands = std::min(partials.size(), rows / MIN_BAND_ROWS);
+    if (bands <= 1 || pool.size() == 1) {
+        return scan(data, rowStride, region);
+    }
+    
+    pool.parallelFor(bands, [&](size_t band) {
+        Region slice = region;
+        slice.y0 = region.y0 + rows * band / bands;
+        slice.y1 = region.y0 + rows * (band + 1) / bands;
+        partials[band].moments = scan(data, rowStride, slice);
+    });
+    
+    SegmentMoments total;
+    for (size_t band = 0; band < bands; band++) {
+        total += partials[band].moments;
+    }
+    return total;
+}
@@ -1,9 +1,12 @@
 #include "PlotWindow.h"
 #include <QVBoxLayout>
 #include <QWidget>
+#include <algorithm>
+#include <cmath>
 
 PlotWindow::PlotWindow(QWidget *parent) 
-    : QMainWindow(parent), startTime(0) {
+    : QMainWindow(parent), history(COLUMN_COUNT, HISTORY_ROWS), bucketWidth(0), openBucket(0),
+      startTime(0), telemetry(nullptr), telemetryOrigin(-1.0) {
     
     // Create central widget and layout
     QWidget *centralWidget = new QWidget(this);
@@ -93,57 +96,95 @@ void PlotWindow::addDataPoint(double errorX, double errorY,
                             double eyeX, double eyeY,
                             double neckPitch, double neckYaw) {
     double currentTime = QDateTime::currentMSecsSinceEpoch() / 1000.0 - startTime;
-    
-    // Add new data
-    timePoints.push_back(currentTime);
-    errorXData.push_back(errorX);
-    errorYData.push_back(errorY);
-    eyeXData.push_back(eyeX);
-    eyeYData.push_back(eyeY);
-    neckPitchData.push_back(neckPitch);
-    neckYawData.push_back(neckYaw);
-    
-    // Remove old data if necessary
-    if (timePoints.size() > MAX_POINTS) {
-        timePoints.pop_front();
-        errorXData.pop_front();
-        errorYData.pop_front();
-        eyeXData.pop_front();
-        eyeYData.pop_front();
-        neckPitchData.pop_front();
-        neckYawData.pop_front();
+    appendPoint(currentTime, errorX, errorY, eyeX, eyeY, neckPitch, neckYaw);
+}
+
+void PlotWindow::setTelemetrySource(const TelemetryChannel* channel) {
+    telemetry = channel;
+    if (telemetry) {
+        telemetryCursor = telemetry->tail();
     }
 }
 
+QCPGraph* PlotWindow::graphFor(size_t column) const {
+    switch (column) {
+        case ERROR_X: return errorPlot->graph(0);
+        case ERROR_Y: return errorPlot->graph(1);
+        case EYE_YAW: return positionPlot->graph(0);
+        case EYE_TILT: return positionPlot->graph(1);
+        case NECK_YAW: return positionPlot->graph(2);
+        default: return positionPlot->graph(3);
+    }
+}
+
+void PlotWindow::appendPoint(double time, double errorX, double errorY,
+                             double eyeX, double eyeY,
+                             double neckPitch, double neckYaw) {
+    float row[COLUMN_COUNT];
+    row[ERROR_X] = static_cast<float>(errorX);
+    row[ERROR_Y] = static_cast<float>(errorY);
+    row[EYE_YAW] = static_cast<float>(eyeX);
+    row[EYE_TILT] = static_cast<float>(eyeY);
+    row[NECK_YAW] = static_cast<float>(neckYaw);
+    row[NECK_PITCH] = static_cast<float>(neckPitch);
+    history.append(time, row);
+}
+
 void PlotWindow::updatePlot() {
-    if (timePoints.empty()) return;
-    
-    // Convert deques to QVector for plotting
-    QVector<double> time = QVector<double>::fromStdVector(
-        std::vector<double>(timePoints.begin(), timePoints.end()));
-    
-    // Update error plot
-    errorPlot->graph(0)->setData(time, QVector<double>::fromStdVector(
-        std::vector<double>(errorXData.begin(), errorXData.end())));
-    errorPlot->graph(1)->setData(time, QVector<double>::fromStdVector(
-        std::vector<double>(errorYData.begin(), errorYData.end())));
-    
-    // Update position plot
-    positionPlot->graph(0)->setData(time, QVector<double>::fromStdVector(
-        std::vector<double>(eyeXData.begin(), eyeXData.end())));
-    positionPlot->graph(1)->setData(time, QVector<double>::fromStdVector(
-        std::vector<double>(eyeYData.begin(), eyeYData.end())));
-    positionPlot->graph(2)->setData(time, QVector<double>::fromStdVector(
-        std::vector<double>(neckYawData.begin(), neckYawData.end())));
-    positionPlot->graph(3)->setData(time, QVector<double>::fromStdVector(
-        std::vector<double>(neckPitchData.begin(), neckPitchData.end())));
+    // Pull every record published since the last refresh
+    if (telemetry) {
+        telemetry->drain(telemetryCursor, [this](const TelemetrySample& sample) {
+            if (telemetryOrigin < 0) telemetryOrigin = sample.timestamp;
+            appendPoint(sample.timestamp - telemetryOrigin,
+                        sample.errorX, sample.errorY,
+                        sample.eyeYawCommand, sample.eyeTiltCommand,
+                        sample.neckPitch, sample.neckYaw);
+        });
+    }
+    
+    if (history.empty()) return;
     
     // Auto-scale x axis to show all data
-    double minTime = timePoints.front();
-    double maxTime = timePoints.back();
+    double minTime = history.firstTime();
+    double maxTime = history.lastTime();
     errorPlot->xAxis->setRange(minTime, maxTime + 1);
     positionPlot->xAxis->setRange(minTime, maxTime + 1);
     
+    // about one bucket per pixel; a power of two, so the width only changes
+    // when the span doubles or halves
+    const int pixels = std::max(1, std::max(errorPlot->axisRect()->width(), positionPlot->axisRect()->width()));
+    const double width = std::exp2(std::ceil(std::log2((maxTime + 1 - minTime) / pixels)));
+    const int64_t first = static_cast<int64_t>(std::floor(minTime / width));
+    const int64_t last = static_cast<int64_t>(std::floor(maxTime / width));
+    
+    // a new width plots everything again; otherwise only the buckets from
+    // the open one on change, plus the oldest ones the history dropped
+    if (width != bucketWidth) {
+        for (size_t column = 0; column < COLUMN_COUNT; column++) graphFor(column)->data()->clear();
+        bucketWidth = width;
+        openBucket = first;
+    }
+    const int64_t from = std::max(openBucket, first);
+    buckets.resize(static_cast<size_t>(last - from + 1));
+    
+    for (size_t column = 0; column < COLUMN_COUNT; column++) {
+        QSharedPointer<QCPGraphDataContainer> data = graphFor(column)->data();
+        data->removeBefore(first * width - width / 4);
+        data->removeAfter(from * width - width / 4);
+        
+        // min then max of each bucket, so spikes survive at any zoom
+        const size_t count = history.decimate(column, from * width, width, buckets.size(), buckets.data());
+        points.clear();
+        for (size_t i = 0; i < count; i++) {
+            points.append(QCPGraphData(buckets[i].time, buckets[i].min));
+            if (buckets[i].max != buckets[i].min) {
+                points.append(QCPGraphData(buckets[i].time + width / 2, buckets[i].max));
+            }
+        }
+        data->add(points, true);
+    }
+    openBucket = last;
+    
     // Replot
     errorPlot->replot();
     positionPlot->replot();
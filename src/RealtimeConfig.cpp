@@ -0,0 +1,127 @@
+#include "RealtimeConfig.h"
+#include <alloca.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+const char* schedulePolicyName(SchedulePolicy policy) {
+    switch (policy) {
+        case SchedulePolicy::Other: return "other";
+        case SchedulePolicy::Fifo: return "fifo";
+        case SchedulePolicy::RoundRobin: return "rr";
+    }
+    return "unknown";
+}
+
+bool parseSchedulePolicy(const std::string& name, SchedulePolicy& policy) {
+    for (SchedulePolicy candidate : {SchedulePolicy::Other, SchedulePolicy::Fifo, SchedulePolicy::RoundRobin}) {
+        if (name == schedulePolicyName(candidate)) {
+            policy = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string ThreadSchedule::describe() const {
+    std::string text = schedulePolicyName(policy);
+    if (policy != SchedulePolicy::Other) {
+        text += " priority " + std::to_string(priority);
+    }
+    if (!cpus.empty()) {
+        text += " on cpus";
+        for (size_t i = 0; i < cpus.size(); i++) {
+            text += (i == 0 ? " " : ",") + std::to_string(cpus[i]);
+        }
+    }
+    return text;
+}
+
+bool parseCpuList(const std::string& text, std::vector<int>& cpus, std::string& error) {
+    cpus.clear();
+    const char* cursor = text.c_str();
+    while (*cursor) {
+        char* end;
+        const long first = std::strtol(cursor, &end, 10);
+        long last = first;
+        if (end == cursor) break;
+        if (*end == '-') {
+            cursor = end + 1;
+            last = std::strtol(cursor, &end, 10);
+            if (end == cursor) break;
+        }
+        if (first < 0 || last < first || last >= CPU_SETSIZE) {
+            error = "bad cpu range in '" + text + "'";
+            return false;
+        }
+        for (long cpu = first; cpu <= last; cpu++) cpus.push_back(static_cast<int>(cpu));
+        
+        cursor = end;
+        if (*cursor == ',') {
+            cursor++;
+        } else if (*cursor) {
+            break;
+        }
+    }
+    if (*cursor || cpus.empty()) {
+        error = "bad cpu list '" + text + "', expected e.g. 2,3 or 0-3";
+        cpus.clear();
+        return false;
+    }
+    return true;
+}
+
+bool applyThreadSchedule(const ThreadSchedule& schedule, std::string& error) {
+    if (!schedule.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : schedule.cpus) CPU_SET(cpu, &set);
+        const int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (result != 0) {
+            error = std::string("cannot pin thread to cpus: ") + std::strerror(result);
+            return false;
+        }
+    }
+    
+    int policy = SCHED_OTHER;
+    sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    if (schedule.policy != SchedulePolicy::Other) {
+        policy = schedule.policy == SchedulePolicy::Fifo ? SCHED_FIFO : SCHED_RR;
+        param.sched_priority = schedule.priority;
+        if (schedule.priority < sched_get_priority_min(policy) || schedule.priority > sched_get_priority_max(policy)) {
+            error = "priority " + std::to_string(schedule.priority) + " out of range for " +
+                    schedulePolicyName(schedule.policy);
+            return false;
+        }
+    }
+    const int result = pthread_setschedparam(pthread_self(), policy, &param);
+    if (result != 0) {
+        error = std::string("cannot set ") + schedulePolicyName(schedule.policy) + " scheduling: " +
+                std::strerror(result);
+        return false;
+    }
+    return true;
+}
+
+bool lockProcessMemory(std::string& error) {
+    // freed memory stays in the heap, large blocks too
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        error = std::string("cannot lock memory: ") + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void prefaultStack(size_t bytes) {
+    // volatile so the writes are not optimized away
+    volatile unsigned char* stack = static_cast<volatile unsigned char*>(alloca(bytes));
+    for (size_t i = 0; i < bytes; i += 4096) stack[i] = 0;
+}
@@ -0,0 +1,72 @@
+#include "RoiTracker.h"
+#include <algorithm>
+#include <cmath>
+
+RoiTracker::RoiTracker() {
+    reset();
+}
+
+void RoiTracker::reset() {
+    locked = false;
+    centerX = centerY = 0.0;
+    velocityX = velocityY = 0.0;
+    halfWidth = halfHeight = MIN_HALF_SIZE;
+}
+
+Region RoiTracker::searchWindow(size_t width, size_t height) const {
+    if (!locked) return Region{0, 0, width, height};
+
+    // centre the window where the centroid is predicted to land
+    return clampWindow(centerX + velocityX, centerY + velocityY,
+                       halfWidth, halfHeight, width, height);
+}
+
+void RoiTracker::update(const SegmentMoments& moments, double errorX, double errorY) {
+    if (moments.count == 0) {
+        lose();
+        return;
+    }
+
+    const double x = static_cast<double>(moments.sumX) / moments.count;
+    const double y = static_cast<double>(moments.sumY) / moments.count;
+
+    if (locked) {
+        velocityX += VELOCITY_SMOOTHING * ((x - centerX) - velocityX);
+        velocityY += VELOCITY_SMOOTHING * ((y - centerY) - velocityY);
+    } else {
+        velocityX = velocityY = 0.0;
+    }
+    centerX = x;
+    centerY = y;
+
+    // equivalent disc radius of the blob
+    const double radius = std::sqrt(static_cast<double>(moments.count) / M_PI);
+    const double base = std::max(MIN_HALF_SIZE, BLOB_MARGIN * radius);
+    halfWidth = base + VELOCITY_GAIN * std::abs(velocityX) + ERROR_GAIN * std::abs(errorX);
+    halfHeight = base + VELOCITY_GAIN * std::abs(velocityY) + ERROR_GAIN * std::abs(errorY);
+
+    locked = true;
+}
+
+Region RoiTracker::blobWindow(const SegmentMoments& moments, double sampleArea,
+                              size_t width, size_t height) {
+    if (moments.count == 0) return Region{0, 0, width, height};
+
+    const double x = static_cast<double>(moments.sumX) / moments.count;
+    const double y = static_cast<double>(moments.sumY) / moments.count;
+    const double radius = std::sqrt(moments.count * sampleArea / M_PI);
+    const double half = std::max(MIN_HALF_SIZE, BLOB_MARGIN * radius) + std::sqrt(sampleArea);
+    return clampWindow(x, y, half, half, width, height);
+}
+
+Region RoiTracker::clampWindow(double x, double y, double halfWidth, double halfHeight,
+                               size_t width, size_t height) {
+    const double x0 = std::max(0.0, std::floor(x - halfWidth));
+    const double y0 = std::max(0.0, std::floor(y - halfHeight));
+    const double x1 = std::min(static_cast<double>(width), std::ceil(x + halfWidth));
+    const double y1 = std::min(static_cast<double>(height), std::ceil(y + halfHeight));
+
+    if (x1 <= x0 || y1 <= y0) return Region{0, 0, width, height};
+    return Region{static_cast<size_t>(x0), static_cast<size_t>(y0),
+                  static_cast<size_t>(x1), static_cast<size_t>(y1)};
+}
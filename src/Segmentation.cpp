@@ -0,0 +1,302 @@
+#include "Segmentation.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GAZE_SEGMENT_X86 1
+#else
+#define GAZE_SEGMENT_X86 0
+#endif
+
+namespace {
+
+using RowScanner = void (*)(const unsigned char* row, size_t x, size_t x1,
+                            uint64_t& count, uint64_t& sumX);
+
+// the two channels a ratio rule compares the dominant one against
+template <int Dominant> constexpr int OTHER_A = Dominant == 0 ? 1 : 0;
+template <int Dominant> constexpr int OTHER_B = Dominant == 2 ? 1 : 2;
+
+template <int Dominant, int Factor>
+void scanRowScalar(const unsigned char* row, size_t x, size_t x1,
+                   uint64_t& count, uint64_t& sumX) {
+    for (const unsigned char* p = row + 3 * x; x < x1; x++, p += 3) {
+        if (p[Dominant] > Factor * p[OTHER_A<Dominant>] && p[Dominant] > Factor * p[OTHER_B<Dominant>]) {
+            count++;
+            sumX += x;
+        }
+    }
+}
+
+#if GAZE_SEGMENT_X86
+
+// a block of W pixels spans three W-byte vectors. byte b of the block starts
+// a pixel when b % 3 == 0, so loading at +0/+1/+2 puts r/g/b of that pixel in
+// the same lane of three vectors; the other lanes are masked out
+template <size_t W>
+struct LaneTables {
+    alignas(32) unsigned char select[3][W];
+    alignas(32) unsigned char index[3][W];
+};
+
+template <size_t W>
+constexpr LaneTables<W> makeLaneTables() {
+    LaneTables<W> tables{};
+    for (size_t k = 0; k < 3; k++) {
+        for (size_t j = 0; j < W; j++) {
+            const size_t byte = k * W + j;
+            const bool start = byte % 3 == 0;
+            tables.select[k][j] = start ? 0xff : 0x00;
+            tables.index[k][j] = start ? static_cast<unsigned char>(byte / 3) : 0;
+        }
+    }
+    return tables;
+}
+
+constexpr LaneTables<16> kLanes16 = makeLaneTables<16>();
+constexpr LaneTables<32> kLanes32 = makeLaneTables<32>();
+
+__attribute__((target("sse2")))
+uint64_t sumLanes(__m128i v) {
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), v);
+    return lanes[0] + lanes[1];
+}
+
+// saturating a - b - b ... stays non-zero only when a > Factor * b
+template <int Factor>
+__attribute__((target("sse2")))
+inline __m128i exceeds(__m128i a, __m128i b) {
+    for (int i = 0; i < Factor; i++) a = _mm_subs_epu8(a, b);
+    return a;
+}
+
+template <int Dominant, int Factor>
+__attribute__((target("sse2")))
+void scanRowSSE2(const unsigned char* row, size_t x, size_t x1,
+                 uint64_t& count, uint64_t& sumX) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i countAcc = zero;
+    __m128i sumAcc = zero;
+
+    // the +1/+2 loads read two bytes past the block, so a full block is only
+    // taken while at least one more pixel of the window follows it
+    for (; x + 16 < x1; x += 16) {
+        const unsigned char* p = row + 3 * x;
+        __m128i hits = zero;
+        __m128i index = zero;
+
+        for (size_t k = 0; k < 3; k++) {
+            const unsigned char* q = p + 16 * k;
+            const __m128i rgb[3] = {
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(q)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(q + 1)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(q + 2))};
+
+            const __m128i overA = exceeds<Factor>(rgb[Dominant], rgb[OTHER_A<Dominant>]);
+            const __m128i overB = exceeds<Factor>(rgb[Dominant], rgb[OTHER_B<Dominant>]);
+            const __m128i reject = _mm_or_si128(_mm_cmpeq_epi8(overA, zero),
+                                                _mm_cmpeq_epi8(overB, zero));
+            const __m128i hit = _mm_andnot_si128(reject,
+                _mm_load_si128(reinterpret_cast<const __m128i*>(kLanes16.select[k])));
+
+            hits = _mm_add_epi8(hits, _mm_and_si128(hit, one));
+            index = _mm_add_epi64(index, _mm_sad_epu8(_mm_and_si128(hit,
+                _mm_load_si128(reinterpret_cast<const __m128i*>(kLanes16.index[k]))), zero));
+        }
+
+        // per-block hit counts fit in 32 bits, so the x offset is a single mul_epu32
+        const __m128i n = _mm_sad_epu8(hits, zero);
+        countAcc = _mm_add_epi64(countAcc, n);
+        sumAcc = _mm_add_epi64(sumAcc, _mm_add_epi64(index,
+            _mm_mul_epu32(n, _mm_set1_epi64x(static_cast<long long>(x)))));
+    }
+
+    count += sumLanes(countAcc);
+    sumX += sumLanes(sumAcc);
+    scanRowScalar<Dominant, Factor>(row, x, x1, count, sumX);
+}
+
+__attribute__((target("avx2")))
+uint64_t sumLanes(__m256i v) {
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+template <int Factor>
+__attribute__((target("avx2")))
+inline __m256i exceeds(__m256i a, __m256i b) {
+    for (int i = 0; i < Factor; i++) a = _mm256_subs_epu8(a, b);
+    return a;
+}
+
+template <int Dominant, int Factor>
+__attribute__((target("avx2")))
+void scanRowAVX2(const unsigned char* row, size_t x, size_t x1,
+                 uint64_t& count, uint64_t& sumX) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+    __m256i countAcc = zero;
+    __m256i sumAcc = zero;
+
+    for (; x + 32 < x1; x += 32) {
+        const unsigned char* p = row + 3 * x;
+        __m256i hits = zero;
+        __m256i index = zero;
+
+        for (size_t k = 0; k < 3; k++) {
+            const unsigned char* q = p + 32 * k;
+            const __m256i rgb[3] = {
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(q)),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(q + 1)),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(q + 2))};
+
+            const __m256i overA = exceeds<Factor>(rgb[Dominant], rgb[OTHER_A<Dominant>]);
+            const __m256i overB = exceeds<Factor>(rgb[Dominant], rgb[OTHER_B<Dominant>]);
+            const __m256i reject = _mm256_or_si256(_mm256_cmpeq_epi8(overA, zero),
+                                                   _mm256_cmpeq_epi8(overB, zero));
+            const __m256i hit = _mm256_andnot_si256(reject,
+                _mm256_load_si256(reinterpret_cast<const __m256i*>(kLanes32.select[k])));
+
+            hits = _mm256_add_epi8(hits, _mm256_and_si256(hit, one));
+            index = _mm256_add_epi64(index, _mm256_sad_epu8(_mm256_and_si256(hit,
+                _mm256_load_si256(reinterpret_cast<const __m256i*>(kLanes32.index[k]))), zero));
+        }
+
+        const __m256i n = _mm256_sad_epu8(hits, zero);
+        countAcc = _mm256_add_epi64(countAcc, n);
+        sumAcc = _mm256_add_epi64(sumAcc, _mm256_add_epi64(index,
+            _mm256_mul_epu32(n, _mm256_set1_epi64x(static_cast<long long>(x)))));
+    }
+
+    count += sumLanes(countAcc);
+    sumX += sumLanes(sumAcc);
+    scanRowSSE2<Dominant, Factor>(row, x, x1, count, sumX);
+}
+
+#endif
+
+SegmentKernel detectKernel() {
+#if GAZE_SEGMENT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SegmentKernel::AVX2;
+    if (__builtin_cpu_supports("sse2")) return SegmentKernel::SSE2;
+#endif
+    return SegmentKernel::Scalar;
+}
+
+// every kernel is instantiated per rule so the comparisons compile to
+// constant channel picks and an unrolled chain of saturating subtractions
+template <int Dominant, int Factor>
+RowScanner scannerFor(SegmentKernel kernel) {
+    switch (kernel) {
+#if GAZE_SEGMENT_X86
+        case SegmentKernel::AVX2: return scanRowAVX2<Dominant, Factor>;
+        case SegmentKernel::SSE2: return scanRowSSE2<Dominant, Factor>;
+#endif
+        default: return scanRowScalar<Dominant, Factor>;
+    }
+}
+
+template <int Dominant>
+RowScanner scannerFor(SegmentKernel kernel, int factor) {
+    switch (factor) {
+        case 1: return scannerFor<Dominant, 1>(kernel);
+        case 3: return scannerFor<Dominant, 3>(kernel);
+        default: return scannerFor<Dominant, 2>(kernel);
+    }
+}
+
+RowScanner scannerFor(SegmentKernel kernel, const RatioRule& rule) {
+    switch (rule.dominant) {
+        case 1: return scannerFor<1>(kernel, rule.factor);
+        case 2: return scannerFor<2>(kernel, rule.factor);
+        default: return scannerFor<0>(kernel, rule.factor);
+    }
+}
+
+} // namespace
+
+SegmentKernel activeSegmentKernel() {
+    static const SegmentKernel kernel = detectKernel();
+    return kernel;
+}
+
+const char* segmentKernelName(SegmentKernel kernel) {
+    switch (kernel) {
+        case SegmentKernel::AVX2: return "avx2";
+        case SegmentKernel::SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+bool segmentKernelSupported(SegmentKernel kernel) {
+    return static_cast<int>(kernel) <= static_cast<int>(activeSegmentKernel());
+}
+
+bool RatioRule::valid() const {
+    return dominant >= 0 && dominant <= 2 && factor >= 1 && factor <= 3;
+}
+
+SegmentMoments segmentRed(const unsigned char* data, size_t rowStride, const Region& region) {
+    return segmentRatio(data, rowStride, region, RatioRule{}, activeSegmentKernel());
+}
+
+SegmentMoments segmentRed(const unsigned char* data, size_t rowStride, const Region& region,
+                          SegmentKernel kernel) {
+    return segmentRatio(data, rowStride, region, RatioRule{}, kernel);
+}
+
+SegmentMoments segmentRatio(const unsigned char* data, size_t rowStride, const Region& region,
+                            const RatioRule& rule) {
+    return segmentRatio(data, rowStride, region, rule, activeSegmentKernel());
+}
+
+SegmentMoments segmentRatio(const unsigned char* data, size_t rowStride, const Region& region,
+                            const RatioRule& rule, SegmentKernel kernel) {
+    SegmentMoments moments;
+    if (region.empty()) return moments;
+
+    if (!segmentKernelSupported(kernel)) kernel = activeSegmentKernel();
+    const RowScanner scanRow = scannerFor(kernel, rule);
+
+    for (size_t y = region.y0; y < region.y1; y++) {
+        uint64_t rowCount = 0, rowSumX = 0;
+        scanRow(data + y * rowStride, region.x0, region.x1, rowCount, rowSumX);
+        moments.count += rowCount;
+        moments.sumX += rowSumX;
+        moments.sumY += rowCount * y;
+    }
+    return moments;
+}
+
+SegmentMoments segmentRedSubsampled(const unsigned char* data, size_t rowStride,
+                                    const Region& region, size_t step) {
+    return segmentRatioSubsampled(data, rowStride, region, RatioRule{}, step);
+}
+
+SegmentMoments segmentRatioSubsampled(const unsigned char* data, size_t rowStride,
+                                      const Region& region, const RatioRule& rule, size_t step) {
+    SegmentMoments moments;
+    if (region.empty()) return moments;
+    if (step <= 1) return segmentRatio(data, rowStride, region, rule);
+
+    const int a = rule.dominant == 0 ? 1 : 0;
+    const int b = rule.dominant == 2 ? 1 : 2;
+    for (size_t y = region.y0; y < region.y1; y += step) {
+        const unsigned char* row = data + y * rowStride;
+        uint64_t rowCount = 0, rowSumX = 0;
+        for (size_t x = region.x0; x < region.x1; x += step) {
+            const unsigned char* p = row + 3 * x;
+            if (p[rule.dominant] > rule.factor * p[a] && p[rule.dominant] > rule.factor * p[b]) {
+                rowCount++;
+                rowSumX += x;
+            }
+        }
+        moments.count += rowCount;
+        moments.sumX += rowSumX;
+        moments.sumY += rowCount * y;
+    }
+    return moments;
+}
@@ -0,0 +1,344 @@
+#include "SessionLog.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace sessionlog;
+
+namespace {
+
+const char MAGIC[8] = {'G', 'A', 'Z', 'E', 'L', 'O', 'G', '1'};
+constexpr uint32_t VERSION = 1;
+constexpr uint64_t NO_CHUNK = ~uint64_t(0);
+
+constexpr uint64_t align8(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+constexpr uint64_t HEADER_BYTES = align8(sizeof(FileHeader));
+
+} // namespace
+
+SessionLogWriter::SessionLogWriter() :
+    fd(-1),
+    chunkSize(0),
+    offset(0),
+    mappedChunk(NO_CHUNK),
+    mapped(nullptr) {
+}
+
+SessionLogWriter::~SessionLogWriter() {
+    close();
+}
+
+bool SessionLogWriter::open(const std::string& path, size_t requestedChunkSize) {
+    close();
+    
+    // chunks are mapped at their file offset, so they must be page multiples
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    chunkSize = std::max(page, (requestedChunkSize + page - 1) / page * page);
+    
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    
+    if (!mapChunk(0)) {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.headerSize = static_cast<uint32_t>(HEADER_BYTES);
+    header.chunkSize = chunkSize;
+    std::memcpy(mapped, &header, sizeof(header));
+    
+    offset = HEADER_BYTES;
+    index.clear();
+    return true;
+}
+
+bool SessionLogWriter::close() {
+    if (fd < 0) return true;
+    
+    // the index is optional: a reader rebuilds it when it does not fit a chunk
+    const uint64_t indexBytes = index.size() * sizeof(IndexEntry);
+    uint64_t indexOffset = 0;
+    if (indexBytes + sizeof(RecordHeader) <= chunkSize) {
+        unsigned char* payload = reserve(RECORD_INDEX, static_cast<uint32_t>(indexBytes), 0.0);
+        if (payload) {
+            std::memcpy(payload, index.data(), indexBytes);
+            indexOffset = offset - align8(sizeof(RecordHeader) + indexBytes);
+        }
+    }
+    
+    unmapChunk();
+    
+    // header fields that are only known at the end
+    FileHeader header;
+    bool ok = pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header));
+    if (ok) {
+        header.indexOffset = indexOffset;
+        header.recordCount = index.size();
+        ok = pwrite(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header));
+    }
+    
+    // drop the unused tail of the last chunk
+    ok = ftruncate(fd, static_cast<off_t>(offset)) == 0 && ok;
+    ok = ::close(fd) == 0 && ok;
+    fd = -1;
+    index.clear();
+    return ok;
+}
+
+bool SessionLogWriter::mapChunk(uint64_t chunk) {
+    unmapChunk();
+    
+    const off_t end = static_cast<off_t>((chunk + 1) * chunkSize);
+    if (ftruncate(fd, end) != 0) return false;
+    
+    void* address = mmap(nullptr, chunkSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                         static_cast<off_t>(chunk * chunkSize));
+    if (address == MAP_FAILED) return false;
+    
+    mapped = static_cast<unsigned char*>(address);
+    mappedChunk = chunk;
+    return true;
+}
+
+void SessionLogWriter::unmapChunk() {
+    if (!mapped) return;
+    
+    // start write-back of the finished chunk without waiting for it
+    msync(mapped, chunkSize, MS_ASYNC);
+    munmap(mapped, chunkSize);
+    mapped = nullptr;
+    mappedChunk = NO_CHUNK;
+}
+
+unsigned char* SessionLogWriter::reserve(uint32_t type, uint32_t size, double timestamp) {
+    if (fd < 0) return nullptr;
+    
+    const uint64_t total = align8(sizeof(RecordHeader) + size);
+    if (total > chunkSize) return nullptr;
+    
+    // records never straddle chunks; a zero header pads to the boundary
+    uint64_t chunk = offset / chunkSize;
+    if (offset + total > (chunk + 1) * chunkSize) {
+        chunk++;
+        offset = chunk * chunkSize;
+    }
+    if (chunk != mappedChunk && !mapChunk(chunk)) return nullptr;
+    
+    unsigned char* at = mapped + (offset - chunk * chunkSize);
+    const RecordHeader header{type, size, timestamp};
+    std::memcpy(at, &header, sizeof(header));
+    
+    if (type != RECORD_INDEX) {
+        index.push_back(IndexEntry{timestamp, offset, type, 0});
+    }
+    offset += total;
+    return at + sizeof(RecordHeader);
+}
+
+bool SessionLogWriter::appendFrame(double timestamp, const unsigned char* data,
+                                   size_t width, size_t height, size_t rowStride) {
+    const size_t rowBytes = width * 3;
+    const uint64_t size = sizeof(FrameHeader) + rowBytes * height;
+    if (size > UINT32_MAX) return false;
+    
+    unsigned char* payload = reserve(RECORD_FRAME, static_cast<uint32_t>(size), timestamp);
+    if (!payload) return false;
+    
+    const FrameHeader frame{static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+    std::memcpy(payload, &frame, sizeof(frame));
+    unsigned char* pixels = payload + sizeof(frame);
+    if (rowStride == rowBytes) {
+        std::memcpy(pixels, data, rowBytes * height);
+    } else {
+        for (size_t y = 0; y < height; y++) {
+            std::memcpy(pixels + y * rowBytes, data + y * rowStride, rowBytes);
+        }
+    }
+    return true;
+}
+
+bool SessionLogWriter::appendSample(const TelemetrySample& sample) {
+    unsigned char* payload = reserve(RECORD_SAMPLE, sizeof(sample), sample.timestamp);
+    if (!payload) return false;
+    std::memcpy(payload, &sample, sizeof(sample));
+    return true;
+}
+
+SessionLogReader::SessionLogReader() :
+    fd(-1),
+    mapped(nullptr),
+    length(0) {
+}
+
+SessionLogReader::~SessionLogReader() {
+    close();
+}
+
+bool SessionLogReader::open(const std::string& path) {
+    close();
+    
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<uint64_t>(info.st_size) < HEADER_BYTES) {
+        close();
+        return false;
+    }
+    length = static_cast<size_t>(info.st_size);
+    
+    void* address = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        mapped = nullptr;
+        close();
+        return false;
+    }
+    mapped = static_cast<const unsigned char*>(address);
+    
+    FileHeader header;
+    std::memcpy(&header, mapped, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.chunkSize == 0) {
+        close();
+        return false;
+    }
+    
+    // use the stored index when the log was closed cleanly
+    bool indexed = false;
+    if (header.indexOffset != 0 && header.indexOffset + sizeof(RecordHeader) <= length) {
+        RecordHeader record;
+        std::memcpy(&record, mapped + header.indexOffset, sizeof(record));
+        const uint64_t end = header.indexOffset + sizeof(RecordHeader) + record.size;
+        if (record.type == RECORD_INDEX && end <= length && record.size % sizeof(IndexEntry) == 0) {
+            index.resize(record.size / sizeof(IndexEntry));
+            std::memcpy(index.data(), mapped + header.indexOffset + sizeof(RecordHeader), record.size);
+            indexed = validIndex(header.headerSize);
+        }
+    }
+    if (!indexed && !scan()) {
+        close();
+        return false;
+    }
+    
+    // records are appended in arrival order, the index is kept in time order
+    std::stable_sort(index.begin(), index.end(),
+                     [](const IndexEntry& a, const IndexEntry& b) { return a.timestamp < b.timestamp; });
+    return true;
+}
+
+void SessionLogReader::close() {
+    if (mapped) {
+        munmap(const_cast<unsigned char*>(mapped), length);
+        mapped = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    length = 0;
+    index.clear();
+}
+
+bool SessionLogReader::validIndex(uint64_t headerSize) const {
+    // every entry must point at a whole record of its type inside the file,
+    // a log closed cleanly can still have been truncated or damaged later
+    for (const IndexEntry& entry : index) {
+        if (entry.offset < headerSize || entry.offset > length - sizeof(RecordHeader)) return false;
+        RecordHeader record;
+        std::memcpy(&record, mapped + entry.offset, sizeof(record));
+        if (record.size > length - entry.offset - sizeof(RecordHeader) || record.type != entry.type ||
+            record.type == RECORD_PAD || record.type >= RECORD_INDEX) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SessionLogReader::scan() {
+    FileHeader header;
+    std::memcpy(&header, mapped, sizeof(header));
+    const uint64_t chunkSize = header.chunkSize;
+    
+    index.clear();
+    uint64_t position = header.headerSize;
+    while (position + sizeof(RecordHeader) <= length) {
+        const uint64_t chunkEnd = (position / chunkSize + 1) * chunkSize;
+        if (chunkEnd - position < sizeof(RecordHeader)) {
+            position = chunkEnd;
+            continue;
+        }
+        
+        RecordHeader record;
+        std::memcpy(&record, mapped + position, sizeof(record));
+        if (record.type == RECORD_PAD) {
+            position = chunkEnd;
+            continue;
+        }
+        
+        // a torn record at the end of an unclosed log ends the scan
+        const uint64_t end = position + align8(sizeof(RecordHeader) + record.size);
+        if (record.type > RECORD_INDEX || end > length || end > chunkEnd) break;
+        
+        if (record.type != RECORD_INDEX) {
+            index.push_back(IndexEntry{record.timestamp, position, record.type, 0});
+        }
+        position = end;
+    }
+    return true;
+}
+
+size_t SessionLogReader::seek(double timestamp) const {
+    const auto it = std::lower_bound(index.begin(), index.end(), timestamp,
+        [](const IndexEntry& entry, double t) { return entry.timestamp < t; });
+    return static_cast<size_t>(it - index.begin());
+}
+
+size_t SessionLogReader::next(size_t i, uint32_t type) const {
+    for (; i < index.size(); i++) {
+        if (index[i].type == type) return i;
+    }
+    return index.size();
+}
+
+SessionLogReader::Record SessionLogReader::record(size_t i) const {
+    RecordHeader header;
+    std::memcpy(&header, mapped + index[i].offset, sizeof(header));
+    return Record{header.type, header.timestamp,
+                  mapped + index[i].offset + sizeof(RecordHeader), header.size};
+}
+
+bool SessionLogReader::frame(size_t i, Frame& frame) const {
+    if (i >= index.size()) return false;
+    
+    const Record entry = record(i);
+    if (entry.type != RECORD_FRAME || entry.size < sizeof(FrameHeader)) return false;
+    
+    FrameHeader header;
+    std::memcpy(&header, entry.payload, sizeof(header));
+    const uint64_t pixels = static_cast<uint64_t>(header.width) * header.height * 3;
+    if (sizeof(FrameHeader) + pixels > entry.size) return false;
+    
+    frame.timestamp = entry.timestamp;
+    frame.width = header.width;
+    frame.height = header.height;
+    frame.rowStride = header.width * 3;
+    frame.data = entry.payload + sizeof(FrameHeader);
+    return true;
+}
+
+bool SessionLogReader::sample(size_t i, TelemetrySample& sample) const {
+    if (i >= index.size()) return false;
+    
+    const Record entry = record(i);
+    if (entry.type != RECORD_SAMPLE || entry.size != sizeof(TelemetrySample)) return false;
+    std::memcpy(&sample, entry.payload, sizeof(sample));
+    return true;
+}
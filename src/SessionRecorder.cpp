@@ -0,0 +1,117 @@
+#include "SessionRecorder.h"
+#include <algorithm>
+#include <chrono>
+
+SessionRecorder::SessionRecorder(const TelemetryChannel& telemetry) :
+    telemetry(telemetry),
+    slotCount(0),
+    nextSequence(0),
+    running(false),
+    stopping(false),
+    droppedFrames(0),
+    lostSamples(0),
+    written(0) {
+}
+
+SessionRecorder::~SessionRecorder() {
+    close();
+}
+
+bool SessionRecorder::open(const std::string& path, size_t frameSlots) {
+    close();
+    if (!writer.open(path)) return false;
+    
+    slotCount = std::max<size_t>(1, frameSlots);
+    slots.reset(new FrameSlot[slotCount]);
+    nextSequence = 0;
+    droppedFrames = 0;
+    lostSamples = 0;
+    written = 0;
+    
+    // record from now on, not what the ring still holds
+    cursor = telemetry.tail();
+    stopping = false;
+    running.store(true, std::memory_order_release);
+    thread = std::thread(&SessionRecorder::writerLoop, this);
+    return true;
+}
+
+void SessionRecorder::close() {
+    if (!thread.joinable()) return;
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+    
+    running.store(false, std::memory_order_release);
+    writer.close();
+    slots.reset();
+    slotCount = 0;
+}
+
+bool SessionRecorder::pushFrame(const FrameRef& frame) {
+    if (!running.load(std::memory_order_acquire)) return false;
+    
+    FrameSlot* slot = nullptr;
+    for (size_t i = 0; i < slotCount; i++) {
+        if (slots[i].state.load(std::memory_order_acquire) == SLOT_FREE) {
+            slot = &slots[i];
+            break;
+        }
+    }
+    if (!slot) {
+        droppedFrames.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    
+    slot->frame = frame;
+    slot->sequence = nextSequence++;
+    slot->state.store(SLOT_READY, std::memory_order_release);
+    return true;
+}
+
+size_t SessionRecorder::writeFrames() {
+    size_t count = 0;
+    for (;;) {
+        // oldest ready slot first, so frames land in arrival order
+        FrameSlot* oldest = nullptr;
+        for (size_t i = 0; i < slotCount; i++) {
+            FrameSlot& slot = slots[i];
+            if (slot.state.load(std::memory_order_acquire) != SLOT_READY) continue;
+            if (!oldest || slot.sequence < oldest->sequence) oldest = &slot;
+        }
+        if (!oldest) return count;
+        
+        const FrameRef& frame = oldest->frame;
+        if (!writer.appendFrame(frame.timestamp(), frame.data(),
+                                frame.width(), frame.height(), frame.rowStride())) {
+            droppedFrames.fetch_add(1, std::memory_order_relaxed);
+        }
+        oldest->frame = FrameRef();  // back to the pool
+        oldest->state.store(SLOT_FREE, std::memory_order_release);
+        count++;
+    }
+}
+
+void SessionRecorder::writerLoop() {
+    const auto interval = std::chrono::duration<double>(WRITE_INTERVAL);
+    bool done = false;
+    while (!done) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait_for(lock, interval, [this] { return stopping; });
+            done = stopping;
+        }
+        
+        // one last pass after the stop request picks up the tail
+        writeFrames();
+        telemetry.drain(cursor, [this](const TelemetrySample& sample) {
+            writer.appendSample(sample);
+        });
+        lostSamples.store(cursor.lost, std::memory_order_relaxed);
+        written.store(writer.bytesWritten(), std::memory_order_relaxed);
+    }
+}
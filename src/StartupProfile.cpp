@@ -0,0 +1,41 @@
+#include "StartupProfile.h"
+#include <cmath>
+#include <sstream>
+#include <thread>
+
+StartupProfile::StartupProfile() :
+    start(Clock::now()),
+    last(start) {
+}
+
+void StartupProfile::mark(const std::string& phase) {
+    const Clock::time_point now = Clock::now();
+    phases.push_back({phase, std::chrono::duration<double>(now - last).count()});
+    last = now;
+}
+
+void StartupProfile::add(const std::string& phase, double seconds) {
+    phases.push_back({phase, seconds});
+}
+
+double StartupProfile::elapsed() const {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::string StartupProfile::describe() const {
+    std::ostringstream text;
+    for (const Phase& phase : phases) {
+        text << phase.name << " " << std::lround(phase.seconds * 1e3) << " ms, ";
+    }
+    text << "total " << std::lround(elapsed() * 1e3) << " ms";
+    return text.str();
+}
+
+bool waitUntil(const std::function<bool()>& ready, double timeout, double poll) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout);
+    while (!ready()) {
+        if (std::chrono::steady_clock::now() >= deadline) return false;
+        std::this_thread::sleep_for(std::chrono::duration<double>(poll));
+    }
+    return true;
+}
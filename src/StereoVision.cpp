@@ -0,0 +1,138 @@
+#include "StereoVision.h"
+#include <cmath>
+#include <utility>
+
+namespace {
+
+constexpr double DEG = M_PI / 180.0;
+
+} // namespace
+
+StereoPairer::StereoPairer(double maxSkew) :
+    maxSkew(maxSkew),
+    unpaired(0) {
+}
+
+void StereoPairer::reset() {
+    for (Side* side : {&left, &right}) {
+        for (FrameRef& frame : side->frames) frame = FrameRef();
+        side->count = 0;
+    }
+}
+
+void StereoPairer::push(Side& side, FrameRef frame) {
+    if (!frame) return;
+    
+    // the oldest frame makes room; it never found a partner
+    if (side.count == DEPTH) {
+        dropThrough(side, 0);
+        unpaired++;
+    }
+    side.frames[side.count++] = std::move(frame);
+}
+
+void StereoPairer::dropThrough(Side& side, size_t index) {
+    const size_t kept = side.count - (index + 1);
+    for (size_t i = 0; i < kept; i++) {
+        side.frames[i] = std::move(side.frames[index + 1 + i]);
+    }
+    for (size_t i = kept; i < side.count; i++) side.frames[i] = FrameRef();
+    side.count = kept;
+}
+
+bool StereoPairer::pair(FrameRef& leftFrame, FrameRef& rightFrame) {
+    leftFrame = FrameRef();
+    rightFrame = FrameRef();
+    
+    // newest match first; both sides hold at most DEPTH frames
+    for (size_t l = left.count; l-- > 0;) {
+        for (size_t r = right.count; r-- > 0;) {
+            const double skew = left.frames[l].timestamp() - right.frames[r].timestamp();
+            if (std::abs(skew) > maxSkew) continue;
+            
+            leftFrame = std::move(left.frames[l]);
+            rightFrame = std::move(right.frames[r]);
+            unpaired += l + r;
+            dropThrough(left, l);
+            dropThrough(right, r);
+            return true;
+        }
+    }
+    return false;
+}
+
+StereoDetector::StereoDetector(TargetDetector& leftDetector, TargetDetector& rightDetector,
+                               std::function<void()> threadStart) :
+    leftDetector(leftDetector),
+    rightDetector(rightDetector),
+    lanes(2, std::move(threadStart)),
+    mismatches(0) {
+}
+
+StereoDetection StereoDetector::detect(const FrameRef& leftFrame, const FrameRef& rightFrame) {
+    StereoDetection detection;
+    SegmentMoments moments[2];
+    bool found[2] = {false, false};
+    
+    lanes.parallelFor(2, [&](size_t eye) {
+        TargetDetector& detector = eye == 0 ? leftDetector : rightDetector;
+        const FrameRef& frame = eye == 0 ? leftFrame : rightFrame;
+        found[eye] = detector.detect(frame.data(), frame.rowStride(), frame.width(), frame.height(),
+                                     moments[eye]);
+    });
+    
+    if (found[0]) {
+        detection.left = true;
+        detection.leftPixels = moments[0].count;
+        detection.leftX = static_cast<double>(moments[0].sumX) / moments[0].count - leftFrame.width() / 2.0;
+        detection.leftY = static_cast<double>(moments[0].sumY) / moments[0].count - leftFrame.height() / 2.0;
+    }
+    if (found[1]) {
+        detection.right = true;
+        detection.rightPixels = moments[1].count;
+        detection.rightX = static_cast<double>(moments[1].sumX) / moments[1].count - rightFrame.width() / 2.0;
+        detection.rightY = static_cast<double>(moments[1].sumY) / moments[1].count - rightFrame.height() / 2.0;
+    }
+    
+    // the eyes locked on different objects: the left one leads
+    if (detection.left && detection.right &&
+        std::abs(detection.leftY - detection.rightY) > ROW_TOLERANCE * rightFrame.height()) {
+        detection.right = false;
+        rightDetector.reset();
+        mismatches++;
+    }
+    return detection;
+}
+
+StereoGeometry::StereoGeometry(double horizontalFov, double baseline) :
+    horizontalFov(horizontalFov),
+    baseline(baseline) {
+}
+
+bool StereoGeometry::triangulate(const StereoDetection& detection, size_t width,
+                                 double version, double vergence, double tilt, StereoTarget& target) const {
+    if (!detection.left || !detection.right || width == 0) return false;
+    
+    // ray directions from each eye, positive to the right and up
+    const double focal = width / (2.0 * std::tan(horizontalFov * DEG / 2.0));
+    const double leftAzimuth = (version + vergence / 2.0) * DEG + std::atan(detection.leftX / focal);
+    const double rightAzimuth = (version - vergence / 2.0) * DEG + std::atan(detection.rightX / focal);
+    const double elevation = tilt * DEG - std::atan((detection.leftY + detection.rightY) / (2.0 * focal));
+    
+    // x = -b/2 + z tan(left) = b/2 + z tan(right)
+    const double spread = std::tan(leftAzimuth) - std::tan(rightAzimuth);
+    if (spread <= 0.0) return false;
+    const double z = baseline / spread;
+    const double x = -baseline / 2.0 + z * std::tan(leftAzimuth);
+    const double y = std::hypot(x, z) * std::tan(elevation);
+    
+    const double distance = std::sqrt(x * x + y * y + z * z);
+    if (distance < MIN_DISTANCE) return false;
+    
+    target.x = x;
+    target.y = y;
+    target.z = z;
+    target.distance = distance;
+    target.vergence = (leftAzimuth - rightAzimuth) / DEG;
+    return true;
+}
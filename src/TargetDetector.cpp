@@ -0,0 +1,238 @@
+#include "TargetDetector.h"
+#include <algorithm>
+
+TargetDetector::TargetDetector(WorkerPool& pool, bool roiTracking, TargetPolicy policy) :
+    pool(pool),
+    segmenter(pool),
+    labeler(pool),
+    selector(policy),
+    roiTracking(roiTracking),
+    selected(-1),
+    incremental(false),
+    hasResult(false),
+    lastFound(false),
+    lastTrackedId(0),
+    checked(false),
+    skipChecks(0),
+    backoff(0),
+    frames(0),
+    reusedFrames(0) {
+    segmenter.setClassifier(&classifier);
+    labeler.setClassifier(&classifier);
+}
+
+void TargetDetector::setClassifier(const ColorClassifier& colorClassifier) {
+    classifier = colorClassifier;
+    reset();
+}
+
+void TargetDetector::reset() {
+    roi.reset();
+    selector.reset();
+    selected = -1;
+    
+    // nothing cached survives, the classifier may have changed
+    changes.reset();
+    dirtyTiles.clear();
+    hasResult = false;
+    checked = false;
+    skipChecks = backoff = 0;
+}
+
+void TargetDetector::setIncremental(bool enabled, int threshold) {
+    incremental = enabled;
+    changes.setThreshold(threshold);
+    reset();
+}
+
+bool TargetDetector::detect(const unsigned char* data, size_t rowStride, size_t width, size_t height,
+                            SegmentMoments& moments) {
+    const Region frame{0, 0, width, height};
+    frames++;
+    
+    // the last result stands while nothing changed where this frame would
+    // be searched and no other blob was asked for. a target in motion
+    // changes every frame, so each change backs the comparison off for
+    // twice as many frames as the last, up to MAX_BACKOFF
+    checked = incremental && skipChecks == 0;
+    if (!checked) {
+        skipChecks -= incremental ? 1 : 0;
+    } else if (examine(data, rowStride, frame, searchedRegion(frame))) {
+        backoff = std::min(MAX_BACKOFF, std::max<size_t>(1, backoff * 2));
+        skipChecks = backoff;
+    } else {
+        backoff = 0;
+        if (hasResult && lastTrackedId == selector.getTrackedId()) {
+            reusedFrames++;
+            moments = lastMoments;
+            return lastFound;
+        }
+    }
+    
+    // a window that moves on holds tiles last compared with an older frame,
+    // so the next frame finds them changed and is searched again. only a
+    // result of a compared frame can stand, a frame searched during the
+    // back-off never became the reference
+    const bool found = searchFrame(data, rowStride, frame, moments);
+    hasResult = checked;
+    lastFound = found;
+    lastMoments = moments;
+    lastTrackedId = selector.getTrackedId();
+    return found;
+}
+
+bool TargetDetector::searchFrame(const unsigned char* data, size_t rowStride, const Region& frame,
+                                 SegmentMoments& moments) {
+    const size_t width = frame.x1, height = frame.y1;
+    if (selector.getPolicy() != TargetPolicy::Centroid) {
+        if (!searchBlobs(data, rowStride, frame, moments)) {
+            roi.lose();
+            return false;
+        }
+    } else if (!roiTracking) {
+        moments = segmentFrame(data, rowStride, frame);
+        return moments.count >= MIN_PIXELS;
+    } else if (!search(data, rowStride, frame, moments)) {
+        roi.lose();
+        return false;
+    }
+    if (!roiTracking) return true;
+    
+    // the window follows the target and the gaze error being corrected
+    const double errorX = static_cast<double>(moments.sumX) / moments.count - width / 2.0;
+    const double errorY = static_cast<double>(moments.sumY) / moments.count - height / 2.0;
+    roi.update(moments, errorX, errorY);
+    return true;
+}
+
+bool TargetDetector::search(const unsigned char* data, size_t rowStride, const Region& frame,
+                            SegmentMoments& moments) {
+    // scan only around the last centroid while locked
+    if (roi.isLocked()) {
+        moments = segmenter.segment(data, rowStride, roi.searchWindow(frame.x1, frame.y1));
+        if (moments.count >= MIN_PIXELS) return true;
+    }
+    
+    // reacquire with a subsampled pass, then refine around its centroid. a
+    // pyramid would cost more than a full scan here, it only pays off for
+    // labelling blobs
+    const double sampleArea = COARSE_STEP * COARSE_STEP;
+    const SegmentMoments coarse = classifier.segmentSubsampled(data, rowStride, frame, COARSE_STEP);
+    if (coarse.count * sampleArea >= MIN_PIXELS) {
+        moments = segmenter.segment(data, rowStride,
+                                    RoiTracker::blobWindow(coarse, sampleArea, frame.x1, frame.y1));
+        if (moments.count >= MIN_PIXELS) return true;
+    }
+    
+    // full frame as a last resort, small targets can fall between samples
+    moments = segmentFrame(data, rowStride, frame);
+    return moments.count >= MIN_PIXELS;
+}
+
+Region TargetDetector::searchedRegion(const Region& frame) const {
+    return roiTracking && roi.isLocked() ? roi.searchWindow(frame.x1, frame.y1) : frame;
+}
+
+bool TargetDetector::examine(const unsigned char* data, size_t rowStride, const Region& frame,
+                             const Region& searched) {
+    const size_t changed = changes.update(data, rowStride, frame.x1, frame.y1, searched);
+    if (dirtyTiles.size() != changes.tileCount()) {
+        dirtyTiles.assign(changes.tileCount(), 1);
+        tileMoments.assign(changes.tileCount(), SegmentMoments());
+        frameMoments = SegmentMoments();
+    }
+    for (size_t tile = 0; changed && tile < dirtyTiles.size(); tile++) {
+        dirtyTiles[tile] |= changes.isChanged(tile) ? 1 : 0;
+    }
+    return changed > 0;
+}
+
+SegmentMoments TargetDetector::segmentFrame(const unsigned char* data, size_t rowStride, const Region& frame) {
+    // the tile moments follow the compared frames only
+    if (!checked) return segmenter.segment(data, rowStride, frame);
+    
+    // the tiles changed since their last scan leave the total, are scanned
+    // again, on the pool when there are several, and come back in. a tile
+    // flagged on an earlier frame has that frame as its reference, so it
+    // takes this one: the next comparison is against the pixels scanned
+    rescanTiles.clear();
+    for (size_t tile = 0; tile < dirtyTiles.size(); tile++) {
+        if (!dirtyTiles[tile]) continue;
+        rescanTiles.push_back(tile);
+        frameMoments -= tileMoments[tile];
+        dirtyTiles[tile] = 0;
+    }
+    pool.parallelFor(rescanTiles.size(), [&](size_t i) {
+        const size_t tile = rescanTiles[i];
+        tileMoments[tile] = classifier.segment(data, rowStride, changes.tileRegion(tile));
+        changes.adopt(tile, data, rowStride);
+    });
+    for (size_t tile : rescanTiles) {
+        frameMoments += tileMoments[tile];
+    }
+    return frameMoments;
+}
+
+bool TargetDetector::searchBlobs(const unsigned char* data, size_t rowStride, const Region& frame,
+                                 SegmentMoments& moments) {
+    // label the roi window while locked, then the candidates of the coarse
+    // level, then the whole frame; a coarse centroid would merge the blobs
+    selected = -1;
+    if (roiTracking && roi.isLocked()) {
+        blobs = labeler.label(data, rowStride, roi.searchWindow(frame.x1, frame.y1), MIN_PIXELS);
+        selected = selector.select(blobs);
+    }
+    if (selected < 0) {
+        reacquireBlobs(data, rowStride, frame);
+        selected = selector.select(blobs);
+    }
+    if (selected < 0) {
+        blobs = labeler.label(data, rowStride, frame, MIN_PIXELS);
+        selected = selector.select(blobs);
+    }
+    if (selected < 0) return false;
+    
+    moments = blobs[selected].moments;
+    return true;
+}
+
+void TargetDetector::reacquireBlobs(const unsigned char* data, size_t rowStride, const Region& frame) {
+    blobs.clear();
+    pyramid.build(data, rowStride, frame.x1, frame.y1, PYRAMID_LEVELS);
+    const ImagePyramid::Level& coarse = pyramid.coarsest();
+    if (coarse.scale == 1) return;  // too small for a pyramid
+    
+    // one level pixel of margin covers the edges the box filter washed out
+    const size_t s = coarse.scale;
+    const uint64_t minArea = std::max<uint64_t>(1, MIN_PIXELS / (s * s));
+    windows.clear();
+    for (const Blob& candidate : labeler.label(coarse.data, coarse.rowStride,
+                                               Region{0, 0, coarse.width, coarse.height}, minArea)) {
+        if (windows.size() == MAX_CANDIDATES) break;
+        Region window{(candidate.box.x0 > 0 ? candidate.box.x0 - 1 : 0) * s,
+                      (candidate.box.y0 > 0 ? candidate.box.y0 - 1 : 0) * s,
+                      std::min(frame.x1, (candidate.box.x1 + 1) * s),
+                      std::min(frame.y1, (candidate.box.y1 + 1) * s)};
+        
+        // overlapping windows are merged so no blob is labelled twice
+        for (size_t i = 0; i < windows.size();) {
+            const Region& other = windows[i];
+            if (other.x0 < window.x1 && window.x0 < other.x1 && other.y0 < window.y1 && window.y0 < other.y1) {
+                window = Region{std::min(window.x0, other.x0), std::min(window.y0, other.y0),
+                                std::max(window.x1, other.x1), std::max(window.y1, other.y1)};
+                windows.erase(windows.begin() + i);
+                i = 0;
+            } else {
+                i++;
+            }
+        }
+        windows.push_back(window);
+    }
+    
+    for (const Region& window : windows) {
+        const std::vector<Blob>& found = labeler.label(data, rowStride, window, MIN_PIXELS);
+        blobs.insert(blobs.end(), found.begin(), found.end());
+    }
+    std::sort(blobs.begin(), blobs.end(),
+              [](const Blob& a, const Blob& b) { return a.area() > b.area(); });
+}
@@ -0,0 +1,133 @@
+#include "TargetPredictor.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double DEG = M_PI / 180.0;
+
+// head-fixed gaze direction, the sign conventions of GazeController
+double gazeAzimuthOf(const GazeController::Encoders& head) { return head.eyeYaw - head.neckYaw; }
+double gazeElevationOf(const GazeController::Encoders& head) { return head.eyeTilt + head.neckPitch; }
+
+} // namespace
+
+void TargetPredictor::Axis::init(double z) {
+    position = z;
+    velocity = 0.0;
+    p00 = MEASUREMENT_NOISE * MEASUREMENT_NOISE;
+    p01 = 0.0;
+    p11 = INITIAL_VELOCITY * INITIAL_VELOCITY;
+}
+
+void TargetPredictor::Axis::predict(double dt) {
+    position += velocity * dt;
+    
+    // P = F P F' + Q for a white-noise acceleration model
+    const double q = ACCELERATION_NOISE;
+    p00 += dt * (2.0 * p01 + dt * p11) + q * dt * dt * dt / 3.0;
+    p01 += dt * p11 + q * dt * dt / 2.0;
+    p11 += q * dt;
+}
+
+void TargetPredictor::Axis::update(double z) {
+    const double innovation = z - position;
+    const double s = p00 + MEASUREMENT_NOISE * MEASUREMENT_NOISE;
+    const double k0 = p00 / s;
+    const double k1 = p01 / s;
+    
+    position += k0 * innovation;
+    velocity += k1 * innovation;
+    p11 -= k1 * p01;
+    p01 -= k0 * p01;
+    p00 -= k0 * p00;
+}
+
+TargetPredictor::TargetPredictor(double horizontalFov) :
+    horizontalFov(horizontalFov) {
+    reset();
+}
+
+void TargetPredictor::reset() {
+    focal = 0.0;
+    azimuth = elevation = Axis{0.0, 0.0, 0.0, 0.0, 0.0};
+    initialized = false;
+    filterTime = lastMeasurement = 0.0;
+    historyCount = historyNext = 0;
+}
+
+void TargetPredictor::recordHead(double time, const GazeController::Encoders& head) {
+    history[historyNext] = HeadSample{time, gazeAzimuthOf(head), gazeElevationOf(head)};
+    historyNext = (historyNext + 1) % HISTORY;
+    if (historyCount < HISTORY) historyCount++;
+}
+
+bool TargetPredictor::gazeAt(double time, double& gazeAzimuth, double& gazeElevation) const {
+    if (historyCount == 0) return false;
+    
+    // walk back from the newest sample to the pair around time
+    const HeadSample* newer = &history[(historyNext + HISTORY - 1) % HISTORY];
+    for (size_t i = 1; i < historyCount; i++) {
+        const HeadSample* older = &history[(historyNext + HISTORY - 1 - i) % HISTORY];
+        if (older->time <= time && newer->time > older->time) {
+            const double a = std::min(1.0, (time - older->time) / (newer->time - older->time));
+            gazeAzimuth = older->azimuth + a * (newer->azimuth - older->azimuth);
+            gazeElevation = older->elevation + a * (newer->elevation - older->elevation);
+            return true;
+        }
+        newer = older;
+    }
+    
+    // older than the history: the oldest sample is the best guess
+    gazeAzimuth = newer->azimuth;
+    gazeElevation = newer->elevation;
+    return true;
+}
+
+void TargetPredictor::measure(double time, double errorX, double errorY, size_t width) {
+    double gazeAzimuth, gazeElevation;
+    if (!gazeAt(time, gazeAzimuth, gazeElevation)) return;
+    
+    focal = width / (2.0 * std::tan(horizontalFov * DEG / 2.0));
+    const double z0 = gazeAzimuth + std::atan(errorX / focal) / DEG;
+    const double z1 = gazeElevation - std::atan(errorY / focal) / DEG;  // image y points down
+    
+    // a new target or a jump the model cannot explain restarts the filter
+    if (initialized && time >= filterTime) {
+        const double dt = time - filterTime;
+        azimuth.predict(dt);
+        elevation.predict(dt);
+        if (std::abs(z0 - azimuth.position) > GATE || std::abs(z1 - elevation.position) > GATE ||
+            time - lastMeasurement > MAX_COAST) {
+            initialized = false;
+        }
+    } else if (initialized) {
+        return;  // out of order frame
+    }
+    
+    if (initialized) {
+        azimuth.update(z0);
+        elevation.update(z1);
+    } else {
+        azimuth.init(z0);
+        elevation.init(z1);
+        initialized = true;
+    }
+    filterTime = lastMeasurement = time;
+}
+
+bool TargetPredictor::isTracking(double time) const {
+    return initialized && time - lastMeasurement <= MAX_COAST;
+}
+
+bool TargetPredictor::predictError(double time, const GazeController::Encoders& head,
+                                   double& errorX, double& errorY) const {
+    if (!isTracking(time)) return false;
+    
+    const double dt = time - filterTime;
+    const double dx = azimuth.position + azimuth.velocity * dt - gazeAzimuthOf(head);
+    const double dy = elevation.position + elevation.velocity * dt - gazeElevationOf(head);
+    errorX = focal * std::tan(dx * DEG);
+    errorY = -focal * std::tan(dy * DEG);
+    return true;
+}
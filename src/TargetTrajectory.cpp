@@ -0,0 +1,128 @@
+#include "TargetTrajectory.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double LISSAJOUS_RATIO = 0.6;  // y frequency over x frequency
+
+// position of a point bouncing between -amplitude and amplitude
+double triangle(double distance, double amplitude) {
+    if (amplitude <= 0.0) return 0.0;
+    const double phase = std::fmod(distance + amplitude, 4.0 * amplitude);
+    return phase < 2.0 * amplitude ? phase - amplitude : 3.0 * amplitude - phase;
+}
+
+} // namespace
+
+const char* trajectoryKindName(TrajectoryKind kind) {
+    switch (kind) {
+        case TrajectoryKind::Jumps: return "jumps";
+        case TrajectoryKind::Sweep: return "sweep";
+        case TrajectoryKind::Sine: return "sine";
+        case TrajectoryKind::Lissajous: return "lissajous";
+        case TrajectoryKind::Walk: return "walk";
+    }
+    return "unknown";
+}
+
+bool parseTrajectoryKind(const std::string& name, TrajectoryKind& kind) {
+    for (TrajectoryKind candidate : {TrajectoryKind::Jumps, TrajectoryKind::Sweep, TrajectoryKind::Sine,
+                                     TrajectoryKind::Lissajous, TrajectoryKind::Walk}) {
+        if (name == trajectoryKindName(candidate)) {
+            kind = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+TargetTrajectory::TargetTrajectory(const TrajectorySettings& settings) :
+    settings(settings),
+    rng(settings.seed),
+    turn(0.0, WALK_TURN * std::sqrt(WALK_STEP)),
+    heading(0.0) {
+    if (settings.kind == TrajectoryKind::Walk) {
+        heading = std::uniform_real_distribution<double>(-PI, PI)(rng);
+    }
+    path.push_back({settings.centreX, settings.centreY});
+}
+
+void TargetTrajectory::at(double t, double& x, double& y) {
+    t = std::max(0.0, t);
+    const double ax = settings.amplitudeX, ay = settings.amplitudeY;
+    const double omega = ax > 0.0 ? settings.speed / ax : 0.0;
+    x = settings.centreX;
+    y = settings.centreY;
+    
+    switch (settings.kind) {
+        case TrajectoryKind::Jumps:
+            break;
+        case TrajectoryKind::Sweep:
+            x += triangle(settings.speed * t, ax);
+            break;
+        case TrajectoryKind::Sine:
+            x += ax * std::sin(omega * t);
+            break;
+        case TrajectoryKind::Lissajous:
+            x += ax * std::sin(omega * t);
+            y += ay * std::sin(LISSAJOUS_RATIO * omega * t);
+            break;
+        case TrajectoryKind::Walk: {
+            // linear between the grid points around t
+            const double position = t / WALK_STEP;
+            const size_t index = static_cast<size_t>(position);
+            extendWalk(index + 2);
+            const double blend = position - index;
+            x = path[index].x + blend * (path[index + 1].x - path[index].x);
+            y = path[index].y + blend * (path[index + 1].y - path[index].y);
+            break;
+        }
+    }
+}
+
+void TargetTrajectory::extendWalk(size_t points) {
+    const double step = settings.speed * WALK_STEP;
+    while (path.size() < points) {
+        heading += turn(rng);
+        Point next = {path.back().x + step * std::cos(heading), path.back().y + step * std::sin(heading)};
+        
+        // bounce off the box
+        if (std::abs(next.x - settings.centreX) > settings.amplitudeX) {
+            heading = PI - heading;
+            next.x = path.back().x + step * std::cos(heading);
+        }
+        if (std::abs(next.y - settings.centreY) > settings.amplitudeY) {
+            heading = -heading;
+            next.y = path.back().y + step * std::sin(heading);
+        }
+        path.push_back(next);
+    }
+}
+
+void TargetTrajectory::jump(size_t i, double& x, double& y) {
+    extendJumps(i + 1);
+    x = path[i].x;
+    y = path[i].y;
+}
+
+void TargetTrajectory::extendJumps(size_t count) {
+    std::uniform_real_distribution<double> size(settings.minJump, settings.maxJump);
+    std::bernoulli_distribution negative(0.5);
+    auto clamp = [](double value, double centre, double amplitude) {
+        return std::max(centre - amplitude, std::min(centre + amplitude, value));
+    };
+    
+    while (path.size() < count) {
+        // a step of at least minJump on both axes, redrawn when the box cuts it short
+        const Point& last = path.back();
+        Point next = last;
+        for (int attempt = 0; attempt < MAX_JUMP_TRIES; attempt++) {
+            next.x = clamp(last.x + (negative(rng) ? -size(rng) : size(rng)), settings.centreX, settings.amplitudeX);
+            next.y = clamp(last.y + (negative(rng) ? -size(rng) : size(rng)), settings.centreY, settings.amplitudeY);
+            if (std::abs(next.x - last.x) >= settings.minJump && std::abs(next.y - last.y) >= settings.minJump) break;
+        }
+        path.push_back(next);
+    }
+}
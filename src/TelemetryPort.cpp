@@ -0,0 +1,120 @@
+#include "TelemetryPort.h"
+#include "TelemetryWire.h"
+#include <algorithm>
+
+bool TelemetryBatch::read(ConnectionReader& connection) {
+    const int32_t size = connection.expectInt32();
+    if (size < 0 || static_cast<size_t>(size) > MAX_BYTES) return false;
+    bytes.resize(static_cast<size_t>(size));
+    return connection.expectBlock(reinterpret_cast<char*>(bytes.data()), bytes.size());
+}
+
+bool TelemetryBatch::write(ConnectionWriter& connection) const {
+    // the port keeps the batch alive until it is sent, so no copy
+    connection.appendInt32(static_cast<int32_t>(bytes.size()));
+    connection.appendExternalBlock(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return true;
+}
+
+TelemetryPublisher::TelemetryPublisher(const TelemetryChannel& telemetry, double period) :
+    TelemetryPublisher(period) {
+    addSource(telemetry, 0);
+}
+
+TelemetryPublisher::TelemetryPublisher(double period) :
+    PeriodicThread(period),
+    batches(0),
+    lostSamples(0) {
+}
+
+void TelemetryPublisher::addSource(const TelemetryChannel& telemetry, uint32_t source) {
+    sources.push_back(Source{&telemetry, source, telemetry.tail()});
+}
+
+bool TelemetryPublisher::open(const std::string& portName) {
+    // a slow reader queues batches instead of losing them
+    port.setStrict(true);
+    if (!port.open(portName)) return false;
+    
+    for (Source& source : sources) {
+        source.cursor = source.telemetry->tail();
+    }
+    if (!start()) {
+        port.close();
+        return false;
+    }
+    return true;
+}
+
+void TelemetryPublisher::close() {
+    stop();
+    port.interrupt();
+    port.close();
+}
+
+void TelemetryPublisher::run() {
+    // nobody listening: skip what was published and encode nothing
+    const bool listened = port.getOutputCount() > 0;
+    uint64_t lost = 0;
+    for (Source& source : sources) {
+        if (!listened) {
+            source.cursor.next = source.telemetry->published();
+            continue;
+        }
+        
+        pending.clear();
+        source.telemetry->drain(source.cursor, [this](const TelemetrySample& sample) {
+            pending.push_back(sample);
+        });
+        lost += source.cursor.lost;
+        
+        for (size_t first = 0; first < pending.size(); first += telemetrywire::MAX_BATCH) {
+            const size_t count = std::min(pending.size() - first, telemetrywire::MAX_BATCH);
+            TelemetryBatch& batch = port.prepare();
+            telemetrywire::encode(pending.data() + first, count, batch.bytes, source.id);
+            port.writeStrict();
+            batches.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (listened) lostSamples.store(lost, std::memory_order_relaxed);
+}
+
+TelemetryReceiver::TelemetryReceiver(TelemetryChannel& telemetry, uint32_t source) :
+    telemetry(telemetry),
+    source(source),
+    hasTick(false),
+    lastTick(0),
+    missedTicks(0),
+    badBatches(0) {
+}
+
+bool TelemetryReceiver::open(const std::string& portName) {
+    port.setStrict(true);
+    port.useCallback(*this);
+    return port.open(portName);
+}
+
+void TelemetryReceiver::close() {
+    port.interrupt();
+    port.close();
+}
+
+void TelemetryReceiver::onRead(TelemetryBatch& batch) {
+    decoded.clear();
+    uint32_t from = 0;
+    if (!telemetrywire::decode(batch.bytes.data(), batch.bytes.size(), decoded, from)) {
+        badBatches.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (from != source) return;  // another instance on a shared port
+    
+    // the port thread is the ring's only producer
+    for (const TelemetrySample& sample : decoded) {
+        if (hasTick && sample.tick > lastTick + 1) {
+            missedTicks.fetch_add(sample.tick - lastTick - 1, std::memory_order_relaxed);
+        }
+        hasTick = true;
+        lastTick = sample.tick;
+        telemetry.publish(sample);
+    }
+}
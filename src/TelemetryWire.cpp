@@ -0,0 +1,83 @@
+#include "TelemetryWire.h"
+#include <cstring>
+
+namespace telemetrywire {
+
+namespace {
+
+constexpr char MAGIC[4] = {'G', 'Z', 'T', 'B'};
+
+} // namespace
+
+void encode(const TelemetrySample* samples, size_t count, std::vector<unsigned char>& out,
+            uint32_t source) {
+    out.resize(sizeof(BatchHeader) + count * sizeof(Record));
+    
+    BatchHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.count = static_cast<uint16_t>(count);
+    header.source = source;
+    header.reserved = 0;
+    header.firstTick = count > 0 ? samples[0].tick : 0;
+    header.firstTime = count > 0 ? samples[0].timestamp : 0.0;
+    std::memcpy(out.data(), &header, sizeof(header));
+    
+    unsigned char* cursor = out.data() + sizeof(header);
+    for (size_t i = 0; i < count; i++, cursor += sizeof(Record)) {
+        const TelemetrySample& sample = samples[i];
+        Record record;
+        record.time = static_cast<float>(sample.timestamp - header.firstTime);
+        record.tick = static_cast<uint32_t>(sample.tick - header.firstTick);
+        record.errorX = static_cast<float>(sample.errorX);
+        record.errorY = static_cast<float>(sample.errorY);
+        record.eyeYawCommand = static_cast<float>(sample.eyeYawCommand);
+        record.eyeTiltCommand = static_cast<float>(sample.eyeTiltCommand);
+        record.eyeYaw = static_cast<float>(sample.eyeYaw);
+        record.eyeTilt = static_cast<float>(sample.eyeTilt);
+        record.neckPitch = static_cast<float>(sample.neckPitch);
+        record.neckYaw = static_cast<float>(sample.neckYaw);
+        record.pixels = (sample.pixelCount & ~MEASURED_BIT) | (sample.measured ? MEASURED_BIT : 0);
+        std::memcpy(record.stageTime, sample.stageTime, sizeof(record.stageTime));
+        record.tickTime = sample.tickTime;
+        record.cameraLatency = sample.cameraLatency;
+        std::memcpy(cursor, &record, sizeof(record));
+    }
+}
+
+bool decode(const unsigned char* data, size_t size, std::vector<TelemetrySample>& samples,
+            uint32_t& source) {
+    if (size < sizeof(BatchHeader)) return false;
+    
+    BatchHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) return false;
+    if (size != sizeof(header) + header.count * sizeof(Record)) return false;
+    source = header.source;
+    
+    const unsigned char* cursor = data + sizeof(header);
+    for (size_t i = 0; i < header.count; i++, cursor += sizeof(Record)) {
+        Record record;
+        std::memcpy(&record, cursor, sizeof(record));
+        TelemetrySample sample;
+        sample.timestamp = header.firstTime + record.time;
+        sample.tick = header.firstTick + record.tick;
+        sample.errorX = record.errorX;
+        sample.errorY = record.errorY;
+        sample.eyeYawCommand = record.eyeYawCommand;
+        sample.eyeTiltCommand = record.eyeTiltCommand;
+        sample.eyeYaw = record.eyeYaw;
+        sample.eyeTilt = record.eyeTilt;
+        sample.neckPitch = record.neckPitch;
+        sample.neckYaw = record.neckYaw;
+        sample.pixelCount = record.pixels & ~MEASURED_BIT;
+        sample.measured = (record.pixels & MEASURED_BIT) ? 1 : 0;
+        std::memcpy(sample.stageTime, record.stageTime, sizeof(sample.stageTime));
+        sample.tickTime = record.tickTime;
+        sample.cameraLatency = record.cameraLatency;
+        samples.push_back(sample);
+    }
+    return true;
+}
+
+} // namespace telemetrywire
@@ -0,0 +1,134 @@
+#include "TimeSeriesStore.h"
+#include <algorithm>
+#include <limits>
+
+TimeSeriesStore::TimeSeriesStore(size_t columns, size_t capacity) :
+    columnCount(std::max<size_t>(1, columns)),
+    rowCapacity(0),
+    levelCount(1),
+    next(0) {
+    // the largest block fits in the ring and the ring holds whole blocks of
+    // every level, so a block's rows are overwritten together
+    size_t topBlock = 1;
+    while (topBlock * FANOUT <= capacity && levelCount < MAX_LEVELS) {
+        topBlock *= FANOUT;
+        levelCount++;
+    }
+    rowCapacity = std::max<size_t>(1, (capacity + topBlock - 1) / topBlock) * topBlock;
+    times.reset(new double[rowCapacity]);
+    values.reset(new float[rowCapacity * columnCount]);
+    
+    size_t blockRows = 1;
+    for (size_t level = 1; level < levelCount; level++) {
+        blockRows *= FANOUT;
+        Level& summary = levels[level];
+        summary.blockRows = blockRows;
+        summary.blocks = rowCapacity / blockRows;
+        summary.min.reset(new float[summary.blocks * columnCount]);
+        summary.max.reset(new float[summary.blocks * columnCount]);
+    }
+}
+
+void TimeSeriesStore::clear() {
+    next = 0;
+}
+
+void TimeSeriesStore::append(double time, const float* row) {
+    const size_t slot = static_cast<size_t>(next % rowCapacity);
+    times[slot] = time;
+    for (size_t c = 0; c < columnCount; c++) {
+        values[c * rowCapacity + slot] = row[c];
+    }
+    
+    // the first row of a block resets it, which also retires the block that
+    // used the slot one lap of the ring ago
+    for (size_t level = 1; level < levelCount; level++) {
+        Level& summary = levels[level];
+        const size_t block = static_cast<size_t>((next / summary.blockRows) % summary.blocks);
+        const bool first = next % summary.blockRows == 0;
+        for (size_t c = 0; c < columnCount; c++) {
+            float& min = summary.min[c * summary.blocks + block];
+            float& max = summary.max[c * summary.blocks + block];
+            if (first) {
+                min = max = row[c];
+            } else {
+                min = std::min(min, row[c]);
+                max = std::max(max, row[c]);
+            }
+        }
+    }
+    next++;
+}
+
+uint64_t TimeSeriesStore::lowerBound(double t) const {
+    uint64_t low = oldest(), high = next;
+    while (low < high) {
+        const uint64_t middle = low + (high - low) / 2;
+        if (timeAt(middle) < t) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+void TimeSeriesStore::rangeEnvelope(size_t column, uint64_t begin, uint64_t end,
+                                    float& min, float& max) const {
+    min = std::numeric_limits<float>::infinity();
+    max = -min;
+    
+    // climb to the largest block that starts here and fits, so the walk
+    // goes up through the levels from begin and back down towards end
+    const float* raw = &values[column * rowCapacity];
+    uint64_t row = begin;
+    while (row < end) {
+        size_t level = 0;
+        while (level + 1 < levelCount) {
+            const uint64_t rows = levels[level + 1].blockRows;
+            if (row % rows != 0 || row + rows > end) break;
+            level++;
+        }
+        
+        if (level == 0) {
+            const float value = raw[row % rowCapacity];
+            min = std::min(min, value);
+            max = std::max(max, value);
+            row++;
+        } else {
+            const Level& summary = levels[level];
+            const size_t block = static_cast<size_t>((row / summary.blockRows) % summary.blocks);
+            min = std::min(min, summary.min[column * summary.blocks + block]);
+            max = std::max(max, summary.max[column * summary.blocks + block]);
+            row += summary.blockRows;
+        }
+    }
+}
+
+bool TimeSeriesStore::envelope(size_t column, double start, double end, float& min, float& max) const {
+    if (column >= columnCount) return false;
+    const uint64_t begin = lowerBound(start);
+    const uint64_t stop = lowerBound(end);
+    if (begin >= stop) return false;
+    rangeEnvelope(column, begin, stop, min, max);
+    return true;
+}
+
+size_t TimeSeriesStore::decimate(size_t column, double start, double width, size_t buckets,
+                                 Bucket* out) const {
+    if (column >= columnCount || width <= 0.0) return 0;
+    
+    size_t written = 0;
+    uint64_t begin = lowerBound(start);
+    for (size_t i = 0; i < buckets && begin < next; i++) {
+        // boundaries from the bucket index, so neighbours agree on them
+        const uint64_t end = lowerBound(start + (i + 1) * width);
+        if (end > begin) {
+            Bucket& bucket = out[written++];
+            bucket.time = start + i * width;
+            rangeEnvelope(column, begin, end, bucket.min, bucket.max);
+        }
+        begin = end;
+    }
+    return written;
+}
@@ -0,0 +1,91 @@
+#include "WorkerPool.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool(size_t lanes, std::function<void()> threadStart) :
+    task(nullptr),
+    taskCount(0),
+    generation(0),
+    busyWorkers(0),
+    stopping(false),
+    nextIndex(0) {
+    if (lanes == 0) {
+        lanes = std::max(1u, std::thread::hardware_concurrency());
+    }
+    
+    workers.reserve(lanes - 1);
+    for (size_t i = 1; i < lanes; i++) {
+        workers.emplace_back(&WorkerPool::workerLoop, this, threadStart);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) return;
+    
+    // nothing to share out
+    if (workers.empty() || count == 1) {
+        for (size_t i = 0; i < count; i++) fn(i);
+        return;
+    }
+    
+    std::unique_lock<std::mutex> jobLock(jobMutex, std::try_to_lock);
+    if (!jobLock.owns_lock()) {
+        for (size_t i = 0; i < count; i++) fn(i);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &fn;
+        taskCount = count;
+        nextIndex.store(0, std::memory_order_relaxed);
+        busyWorkers = workers.size();
+        generation++;
+    }
+    wake.notify_all();
+    
+    drain();
+    
+    // the job's state must outlive every worker that joined it
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return busyWorkers == 0; });
+    task = nullptr;
+}
+
+void WorkerPool::workerLoop(std::function<void()> threadStart) {
+    if (threadStart) threadStart();
+    unsigned long seen = 0;
+    
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        
+        drain();
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busyWorkers == 0) done.notify_one();
+    }
+}
+
+void WorkerPool::drain() {
+    // indices are claimed dynamically so uneven tasks still balance
+    for (;;) {
+        const size_t i = nextIndex.fetch_add(1, std::memory_order_relaxed);
+        if (i >= taskCount) return;
+        (*task)(i);
+    }
+}
@@ -0,0 +1,111 @@
+#include "WorldDriver.h"
+#include "StartupProfile.h"
+
+WorldDriver::WorldDriver(const TrajectorySettings& settings, double rate) :
+    PeriodicThread(1.0 / rate),
+    trajectory(settings),
+    startTime(0.0),
+    updates(0) {
+}
+
+bool WorldDriver::open(const std::string& prefix, double timeout, const std::string& worldPort) {
+    const std::string rpcName = prefix + "/world:o";
+    const std::string streamName = prefix + "/worldStream:o";
+    
+    // positions are only worth sending while fresh: a busy connection skips
+    // an update rather than queue it behind the next one
+    streamPort.setStrict(false);
+    if (!rpcPort.open(rpcName) || !streamPort.open(streamName)) {
+        close();
+        return false;
+    }
+    auto connected = [&] {
+        return Network::connect(rpcName, worldPort) && Network::connect(streamName, worldPort);
+    };
+    if (!waitUntil(connected, timeout, POLL)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void WorldDriver::close() {
+    stopMotion();
+    streamPort.interrupt();
+    streamPort.close();
+    rpcPort.close();
+}
+
+bool WorldDriver::createSphere() {
+    Bottle cmd, reply;
+    
+    // clear any existing objects
+    cmd.addString("world");
+    cmd.addString("del");
+    cmd.addString("all");
+    rpcPort.write(cmd, reply);
+    
+    // create new sphere
+    double x, y;
+    if (trajectory.isContinuous()) {
+        trajectory.at(0.0, x, y);
+    } else {
+        trajectory.jump(0, x, y);
+    }
+    cmd.clear();
+    cmd.addString("world");
+    cmd.addString("mk");
+    cmd.addString("ssph");
+    cmd.addFloat64(SPHERE_RADIUS);
+    cmd.addFloat64(x);
+    cmd.addFloat64(y);
+    cmd.addFloat64(SPHERE_Z);
+    cmd.addFloat64(1.0);  // red
+    cmd.addFloat64(0.0);  // green
+    cmd.addFloat64(0.0);  // blue
+    
+    return rpcPort.write(cmd, reply);
+}
+
+bool WorldDriver::moveSphere(double x, double y) {
+    Bottle cmd, reply;
+    addMove(cmd, x, y);
+    return rpcPort.write(cmd, reply);
+}
+
+bool WorldDriver::startMotion() {
+    if (isRunning()) return true;
+    return start();
+}
+
+void WorldDriver::stopMotion() {
+    if (isRunning()) stop();
+}
+
+void WorldDriver::addMove(Bottle& cmd, double x, double y) {
+    cmd.addString("world");
+    cmd.addString("set");
+    cmd.addString("ssph");
+    cmd.addInt32(1);  // sphere id
+    cmd.addFloat64(x);
+    cmd.addFloat64(y);
+    cmd.addFloat64(SPHERE_Z);
+}
+
+bool WorldDriver::threadInit() {
+    startTime = Time::now();
+    return true;
+}
+
+void WorldDriver::run() {
+    // the trajectory runs on the clock, not on the tick count, so late ticks
+    // never slow the target down
+    double x, y;
+    trajectory.at(Time::now() - startTime, x, y);
+    
+    Bottle& cmd = streamPort.prepare();
+    cmd.clear();
+    addMove(cmd, x, y);
+    streamPort.write();
+    updates.fetch_add(1, std::memory_order_relaxed);
+}
@@ -1,187 +1,350 @@
 #include "GazeThread.h"
-#include "PlotWindow.h"
+#include "StartupProfile.h"
+#include "TelemetryPort.h"
+#include "WorkerPool.h"
+#include "WorldDriver.h"
 #include <yarp/os/LogStream.h>
-#include <cstdlib>
-#include <ctime>
+#include <algorithm>
+#include <csignal>
+#include <future>
+#include <string>
+#include <thread>
 #include <vector>
+#include <atomic>
+#ifdef GAZE_WITH_GUI
+#include "PlotWindow.h"
 #include <QApplication>
+#endif
 
-// sphere parameters
-const double SPHERE_RADIUS = 0.04;
-const double SPHERE_Z = 0.8;
+// set from SIGINT/SIGTERM in headless mode, where no window closes the app
+std::atomic<bool> interrupted{false};
 
-// movement boundaries
-const double MIN_X = -0.3;
-const double MAX_X = 0.3;
-const double MIN_Y = 0.6;
-const double MAX_Y = 1.1;
+void onSignal(int) {
+    interrupted = true;
+}
 
-class GazeControlApp {
+// one head: the target sphere in its simulator world and the gaze
+// controller tracking it, with the trials run on them
+class GazeInstance {
 public:
-    GazeControlApp() : plotWindow(nullptr) {}
+    explicit GazeInstance(WorkerPool* sharedWorkers) :
+        sharedWorkers(sharedWorkers), pause(0.0), trials(6), duration(60.0) {}
     
-    bool configure() {
-        if (!yarp.checkNetwork()) {
-            yError() << "yarp network not available";
+    // a started controller must be stopped before its devices are closed
+    ~GazeInstance() {
+        stop();
+    }
+    
+    bool configure(yarp::os::Searchable& rf) {
+        StartupProfile profile;
+        name = rf.check("name", yarp::os::Value("/gazeControl"), "prefix of the controller's ports").asString();
+        const std::string robot = rf.check("robot", yarp::os::Value("/icubSim"), "prefix of the robot's ports").asString();
+        
+        // target motion, seeded so that runs can be repeated exactly; the
+        // default box is the one the jumps always used
+        TrajectorySettings motion;
+        std::string kind = rf.check("motion", yarp::os::Value("jumps"), "jumps, sweep, sine, lissajous or walk").asString();
+        if (!parseTrajectoryKind(kind, motion.kind)) {
+            yError() << "unknown motion" << kind;
             return false;
         }
-
-        // open rpc port for simulator control
-        if (!worldPort.open("/gazeControl/world:o")) {
+        motion.seed = static_cast<unsigned>(rf.check("seed", yarp::os::Value(1), "target motion seed").asInt32());
+        motion.centreX = rf.check("centre_x", yarp::os::Value(0.0), "centre of the target motion in m").asFloat64();
+        motion.centreY = rf.check("centre_y", yarp::os::Value(0.85), "centre of the target motion in m").asFloat64();
+        motion.amplitudeX = rf.check("amplitude_x", yarp::os::Value(0.3), "half width of the target motion in m").asFloat64();
+        motion.amplitudeY = rf.check("amplitude_y", yarp::os::Value(0.25), "half height of the target motion in m").asFloat64();
+        motion.speed = rf.check("speed", yarp::os::Value(0.2), "target speed in m/s").asFloat64();
+        double rate = rf.check("world_rate", yarp::os::Value(WorldDriver::RATE), "target updates per second").asFloat64();
+        if (rate <= 0.0 || motion.amplitudeX < 0.0 || motion.amplitudeY < 0.0 || motion.speed < 0.0) {
+            yError() << "world_rate must be positive, amplitudes and speed not negative";
+            return false;
+        }
+        trials = rf.check("trials", yarp::os::Value(6), "target jumps").asInt32();
+        duration = rf.check("duration", yarp::os::Value(60.0), "seconds of continuous motion").asFloat64();
+        
+        // open world ports for simulator control, once the simulator is up
+        const double startupTimeout = rf.check("startup_timeout", yarp::os::Value(10.0),
+                                               "seconds to wait for the simulator").asFloat64();
+        world.reset(new WorldDriver(motion, rate));
+        if (!world->open(name, startupTimeout, robot + "/world")) {
             yError() << "failed to open world port";
             return false;
         }
-        yarp.connect("/gazeControl/world:o", "/icubSim/world");
 
         // create initial sphere
-        if (!createSphere()) {
+        if (!world->createSphere()) {
             yError() << "failed to create sphere";
             return false;
         }
-        yInfo() << "created sphere successfully";
+        yInfo() << name << "created sphere successfully, motion" << trajectoryKindName(motion.kind) << "seed" << motion.seed;
+        profile.mark("world");
+        
+        // extra seconds at each position once the gaze has settled; none by
+        // default, --dwell already holds a trial until the gaze is steady
+        pause = rf.check("pause", yarp::os::Value(0.0), "seconds between trials").asFloat64();
 
         // start gaze control thread
-        gazeControl.reset(new GazeThread(0.02));  // 50hz control loop
-        if (!gazeControl->configure()) {
+        // the control loop keeps its own rate, camera frames are consumed as they arrive
+        double period = rf.check("period", yarp::os::Value(0.02), "control period in seconds").asFloat64();
+        gazeControl.reset(new GazeThread(period, sharedWorkers));  // 50hz control loop by default
+        if (!gazeControl->configure(rf)) {
             yError() << "failed to configure gaze control";
             return false;
         }
-        gazeControl->start();
-        yInfo() << "started gaze control thread";
-        
-        // create plot window
-        plotWindow = new PlotWindow();
-        plotWindow->show();
+        if (!gazeControl->start()) {
+            yError() << "failed to start gaze control thread";
+            return false;
+        }
+        profile.mark("controller");
+        yInfo() << name << "started gaze control thread," << profile.describe();
         
         return true;
     }
     
+    // records for an in-process plot window
+    const TelemetryChannel& getTelemetry() const {
+        return gazeControl->getTelemetry();
+    }
+    
     void run() {
-        // initialize last position
-        double lastX = 0.0;
-        double lastY = 0.9;
-        
-        // main loop - move sphere randomly
-        for (int iter = 0; iter < 6 && !isStopping; iter++) {
-            yInfo() << "iteration" << iter + 1 << "of 6";
+        if (world->getTrajectory().isContinuous()) {
+            runPursuit();
+        } else {
+            runJumps();
+        }
+    }
+    
+    void stop() {
+        isStopping = true;
+        if (gazeControl) {
+            gazeControl->stop();
+        }
+        if (world) {
+            world->close();
+        }
+    }
+
+private:
+    WorkerPool* sharedWorkers;
+    std::string name;
+    std::unique_ptr<WorldDriver> world;
+    std::unique_ptr<GazeThread> gazeControl;
+    double pause;
+    int trials;
+    double duration;
+    std::atomic<bool> isStopping{false};
+    
+    bool stopping() const {
+        return isStopping || interrupted;
+    }
+    
+    // settling trials: the sphere jumps and the gaze has to settle on it
+    void runJumps() {
+        for (int iter = 0; iter < trials && !stopping(); iter++) {
+            yInfo() << name << "iteration" << iter + 1 << "of" << trials;
             
-            // generate new position
+            // the first jump starts from where the sphere was created
             double newX, newY;
-            generateNewPosition(lastX, lastY, newX, newY);
+            world->getTrajectory().jump(iter + 1, newX, newY);
             
             yInfo() << "moving sphere to (x,y) = (" << newX << "," << newY << ")";
             
-            if (!moveSphere(newX, newY)) {
+            if (!world->moveSphere(newX, newY)) {
                 yError() << "failed to move sphere";
                 continue;
             }
             
-            gazeControl->isMovementDone = false;
+            // the trial only counts frames captured from now on
+            ConvergenceMonitor& convergence = gazeControl->getConvergence();
+            const uint64_t trial = convergence.arm(yarp::os::Time::now());
             
-            // wait for gaze to stabilize
-            while (!gazeControl->isMovementDone && !isStopping) {
-                // update plot with current errors and positions
-                if (plotWindow) {
-                    plotWindow->addDataPoint(
-                        gazeControl->getErrorX(),
-                        gazeControl->getErrorY(),
-                        gazeControl->getEyeX(),
-                        gazeControl->getEyeY(),
-                        gazeControl->getNeckPitch(),
-                        gazeControl->getNeckYaw()
-                    );
-                }
-                yarp::os::Time::delay(0.1);
+            // woken on the control tick the gaze settles; the slices only
+            // look for a stop request, the plot drains telemetry on its own
+            ConvergenceMonitor::Result result;
+            bool decided = false;
+            while (!decided && !stopping()) {
+                decided = convergence.wait(trial, result, 0.1);
             }
+            if (!decided) break;
             
-            yInfo() << "gaze stabilized at position" << iter + 1;
-            yarp::os::Time::delay(2.0);  // pause at each position
-            
-            // update last position
-            lastX = newX;
-            lastY = newY;
+            yInfo() << name << "position" << iter + 1 << convergenceOutcomeName(result.outcome)
+                    << "after" << result.settleTime << "s";
+            if (pause > 0.0) yarp::os::Time::delay(pause);  // pause at each position
         }
     }
     
-    void stop() {
-        isStopping = true;
-        if (gazeControl) {
-            gazeControl->stop();
+    // smooth pursuit: the sphere follows the trajectory for the whole run,
+    // the tracking error is in the telemetry and the session log
+    void runPursuit() {
+        if (!world->startMotion()) {
+            yError() << "failed to start target motion";
+            return;
+        }
+        yInfo() << "target moving for" << duration << "s";
+        
+        const double end = yarp::os::Time::now() + duration;
+        while (!stopping() && yarp::os::Time::now() < end) {
+            yarp::os::Time::delay(0.1);
         }
-        worldPort.close();
-        delete plotWindow;
+        world->stopMotion();
+        yInfo() << name << "target stopped after" << world->getUpdates() << "updates";
     }
+};
 
-private:
-    yarp::os::Network yarp;
-    yarp::os::RpcClient worldPort;
-    std::unique_ptr<GazeThread> gazeControl;
-    PlotWindow* plotWindow;
-    bool isStopping{false};
-    
-    bool createSphere() {
-        yarp::os::Bottle cmd, reply;
+// the process: one head by default, or --heads n controllers that share
+// one segmentation pool and one telemetry port, each with its own world,
+// ports and control thread
+class GazeControlApp {
+public:
+    bool configure(yarp::os::ResourceFinder& rf) {
+        if (!yarp.checkNetwork()) {
+            yError() << "yarp network not available";
+            return false;
+        }
         
-        // clear any existing objects
-        cmd.addString("world");
-        cmd.addString("del");
-        cmd.addString("all");
-        worldPort.write(cmd, reply);
+        const int heads = rf.check("heads", yarp::os::Value(1), "gaze controllers in this process").asInt32();
+        if (heads < 1) {
+            yError() << "heads must be at least 1";
+            return false;
+        }
+        if (heads == 1) {
+            instances.emplace_back(new GazeInstance(nullptr));
+            return instances.back()->configure(rf);
+        }
         
-        // create new sphere
-        cmd.clear();
-        cmd.addString("world");
-        cmd.addString("mk");
-        cmd.addString("ssph");
-        cmd.addFloat64(SPHERE_RADIUS);
-        cmd.addFloat64(0.0);      // initial x
-        cmd.addFloat64(0.9);      // initial y
-        cmd.addFloat64(SPHERE_Z);
-        cmd.addFloat64(1.0);  // red
-        cmd.addFloat64(0.0);  // green
-        cmd.addFloat64(0.0);  // blue
+        // one pool for every head instead of one per head, so dozens of
+        // controllers do not oversubscribe the cores; its workers take the
+        // control threads' scheduling
+        ThreadSchedule control, capture;
+        std::string error;
+        if (!GazeThread::readSchedules(rf, control, capture, error)) {
+            yError() << error;
+            return false;
+        }
+        const int lanes = rf.check("workers", yarp::os::Value(1), "segmentation threads shared by all heads").asInt32();
+        workers.reset(new WorkerPool(static_cast<size_t>(std::max(0, lanes)), [control] {
+            std::string workerError;
+            if (!control.isDefault() && !applyThreadSchedule(control, workerError)) {
+                yError() << "segmentation worker:" << workerError;
+            }
+        }));
         
-        return worldPort.write(cmd, reply);
-    }
-    
-    bool moveSphere(double x, double y) {
-        yarp::os::Bottle cmd, reply;
-        cmd.addString("world");
-        cmd.addString("set");
-        cmd.addString("ssph");
-        cmd.addInt32(1);  // sphere id
-        cmd.addFloat64(x);
-        cmd.addFloat64(y);
-        cmd.addFloat64(SPHERE_Z);
+        // heads come up concurrently, each waiting on its own simulator
+        std::vector<yarp::os::Property> configs(static_cast<size_t>(heads));
+        std::vector<std::future<bool>> configured;
+        for (int i = 0; i < heads; i++) {
+            configs[i] = headConfig(rf, i);
+            instances.emplace_back(new GazeInstance(workers.get()));
+            GazeInstance* instance = instances.back().get();
+            yarp::os::Property* config = &configs[i];
+            configured.push_back(std::async(std::launch::async, [instance, config] {
+                return instance->configure(*config);
+            }));
+        }
+        bool ok = true;
+        for (int i = 0; i < heads; i++) {
+            if (!configured[i].get()) {
+                yError() << "failed to configure head" << i;
+                ok = false;
+            }
+        }
+        if (!ok) {
+            // the heads that did come up are running already
+            stop();
+            return false;
+        }
         
-        return worldPort.write(cmd, reply);
+        // every head's records on one port, tagged with the head's number
+        if (rf.check("telemetry", yarp::os::Value(1), "publish telemetry").asBool()) {
+            const std::string port = rf.check("host", yarp::os::Value("/gazeHost"), "prefix of the shared ports").asString() +
+                                     "/telemetry:o";
+            publisher.reset(new TelemetryPublisher());
+            for (int i = 0; i < heads; i++) {
+                publisher->addSource(instances[i]->getTelemetry(), static_cast<uint32_t>(i));
+            }
+            if (!publisher->open(port)) {
+                yError() << "failed to open telemetry port" << port;
+                return false;
+            }
+        }
+        yInfo() << heads << "heads on" << workers->size() << "shared segmentation threads";
+        return true;
+    }
+    
+    // records of the first head for an in-process plot window
+    const TelemetryChannel& getTelemetry() const {
+        return instances.front()->getTelemetry();
     }
     
-    void generateNewPosition(double lastX, double lastY, double& newX, double& newY) {
-        srand(time(0));
+    void run() {
+        if (instances.size() == 1) {
+            instances.front()->run();
+            return;
+        }
         
-        do {
-            float randomRangeX = -0.1 + static_cast<float>(rand()) / (static_cast<float>(RAND_MAX/(0.2)));
-            float randomRangeY = -0.1 + static_cast<float>(rand()) / (static_cast<float>(RAND_MAX/(0.2)));
-            
-            newX = (randomRangeX < 0) ? lastX + randomRangeX - 0.2 : lastX + randomRangeX + 0.2;
-            newY = (randomRangeY < 0) ? lastY + randomRangeY - 0.2 : lastY + randomRangeY + 0.2;
-            
-            newX = std::max(MIN_X, std::min(MAX_X, newX));
-            newY = std::max(MIN_Y, std::min(MAX_Y, newY));
-            
-        } while (std::abs(newX - lastX) < 0.2 || std::abs(newY - lastY) < 0.2);
+        // the trials mostly wait on convergence, a thread per head is cheap
+        std::vector<std::thread> threads;
+        for (auto& instance : instances) {
+            threads.emplace_back([&instance] { instance->run(); });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+    
+    void stop() {
+        // the publisher reads the heads' telemetry until it is closed
+        if (publisher) {
+            publisher->close();
+        }
+        for (auto& instance : instances) {
+            instance->stop();
+        }
+    }
+
+private:
+    yarp::os::Network yarp;
+    std::unique_ptr<WorkerPool> workers;  // shared, only with several heads
+    std::vector<std::unique_ptr<GazeInstance>> instances;
+    std::unique_ptr<TelemetryPublisher> publisher;  // shared, only with several heads
+    
+    // options of head i: the command line and config file, overridden by
+    // the [head<i>] group. ports and session logs default to numbered names
+    // so heads never clash, and telemetry goes out on the host's port
+    static yarp::os::Property headConfig(yarp::os::ResourceFinder& rf, int index) {
+        const std::string group = "head" + std::to_string(index);
+        const yarp::os::Bottle& own = rf.findGroup(group);
+        yarp::os::Property config;
+        config.fromString(rf.toString());
+        config.fromString(own.tail().toString(), false);
+        if (!own.check("name")) {
+            config.put("name", rf.check("name", yarp::os::Value("/gazeControl")).asString() + "/" + group);
+        }
+        if (!own.check("robot")) {
+            config.put("robot", rf.check("robot", yarp::os::Value("/icubSim")).asString() + std::to_string(index));
+        }
+        if (rf.check("record") && !own.check("record")) {
+            config.put("record", rf.find("record").asString() + "." + group);
+        }
+        config.put("telemetry", 0);
+        return config;
     }
 };
 
-int main(int argc, char *argv[]) {
+#ifdef GAZE_WITH_GUI
+// plot window in this process, the app ends when it is closed
+int runWithPlot(GazeControlApp& gazeApp, yarp::os::ResourceFinder& rf, int argc, char *argv[]) {
     QApplication app(argc, argv);
     
-    GazeControlApp gazeApp;
-    if (!gazeApp.configure()) {
+    if (!gazeApp.configure(rf)) {
         return 1;
     }
     
+    // create plot window
+    std::unique_ptr<PlotWindow> plotWindow(new PlotWindow());
+    plotWindow->setTelemetrySource(&gazeApp.getTelemetry());
+    plotWindow->show();
+    
     // run the gaze control in a separate thread
     std::thread gazeThread([&gazeApp]() {
         gazeApp.run();
@@ -198,3 +361,31 @@ int main(int argc, char *argv[]) {
     
     return result;
 }
+#endif
+
+// no qt at all: vision and control keep the cpu, plots come from
+// gaze_plotter on another machine through /gazeControl/telemetry:o
+int runHeadless(GazeControlApp& gazeApp, yarp::os::ResourceFinder& rf) {
+    if (!gazeApp.configure(rf)) {
+        return 1;
+    }
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    
+    gazeApp.run();
+    gazeApp.stop();
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    yarp::os::ResourceFinder rf;
+    rf.configure(argc, argv);
+    
+    GazeControlApp gazeApp;
+#ifdef GAZE_WITH_GUI
+    if (!rf.check("headless", yarp::os::Value(0), "run without the plot window").asBool()) {
+        return runWithPlot(gazeApp, rf, argc, argv);
+    }
+#endif
+    return runHeadless(gazeApp, rf);
+}
@@ -0,0 +1,51 @@
+#include "PlotWindow.h"
+#include "TelemetryPort.h"
+#include <yarp/os/LogStream.h>
+#include <QApplication>
+#include <algorithm>
+
+// plot window for a controller running elsewhere, usually with --headless:
+// reads the batched telemetry from /gazeControl/telemetry:o, so the only
+// qt process can live on any machine of the yarp network
+int main(int argc, char *argv[]) {
+    QApplication app(argc, argv);
+    
+    yarp::os::ResourceFinder rf;
+    rf.configure(argc, argv);
+    const std::string remote = rf.check("remote", yarp::os::Value("/gazeControl/telemetry:o"),
+                                        "telemetry port of the controller").asString();
+    const std::string local = rf.check("name", yarp::os::Value("/gazePlotter"),
+                                       "prefix of this plotter's port").asString() + "/telemetry:i";
+    const int head = rf.check("head", yarp::os::Value(0), "instance to plot on a multi-head host").asInt32();
+    
+    yarp::os::Network yarp;
+    if (!yarp.checkNetwork()) {
+        yError() << "yarp network not available";
+        return 1;
+    }
+    
+    // decoded records land in a local ring that the window drains as usual
+    TelemetryChannel telemetry;
+    TelemetryReceiver receiver(telemetry, static_cast<uint32_t>(std::max(0, head)));
+    if (!receiver.open(local)) {
+        yError() << "failed to open telemetry port" << local;
+        return 1;
+    }
+    if (!yarp.connect(remote, local)) {
+        yError() << "failed to connect" << remote << "to" << local;
+        receiver.close();
+        return 1;
+    }
+    
+    PlotWindow plotWindow;
+    plotWindow.setTelemetrySource(&telemetry);
+    plotWindow.show();
+    
+    // run qt event loop
+    int result = app.exec();
+    
+    receiver.close();
+    yInfo() << static_cast<int64_t>(receiver.getMissedTicks()) << "ticks missed,"
+            << static_cast<int64_t>(receiver.getBadBatches()) << "unreadable batches";
+    return result;
+}